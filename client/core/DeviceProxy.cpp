@@ -156,7 +156,7 @@ void DeviceProxy::turnOff() {
     }
 }
 
-void DeviceProxy::setTimer(int duration, const std::string& action) {
+int64_t DeviceProxy::setTimer(int duration, const std::string& action) {
     json request = {
         {"action", "set_timer"},
         {"token", token},
@@ -170,9 +170,111 @@ void DeviceProxy::setTimer(int duration, const std::string& action) {
         if (response["status"] != 200) {
             throw std::runtime_error(response["message"]);
         }
+        return response.value("timer_id", static_cast<int64_t>(-1));
     } catch (const std::exception& e) {
         std::cerr << "Error setting timer: " << e.what() << std::endl;
     }
+    return -1;
+}
+
+int64_t DeviceProxy::setIntervalSchedule(int intervalSeconds, const std::string& action) {
+    json request = {
+        {"action", "set_schedule"},
+        {"token", token},
+        {"clientId", clientId},
+        {"interval", intervalSeconds},
+        {"timer_action", action}
+    };
+
+    try {
+        json response = sendRequest(request);
+        if (response["status"] != 200) {
+            throw std::runtime_error(response["message"]);
+        }
+        return response.value("timer_id", static_cast<int64_t>(-1));
+    } catch (const std::exception& e) {
+        std::cerr << "Error setting schedule: " << e.what() << std::endl;
+    }
+    return -1;
+}
+
+int64_t DeviceProxy::setCronSchedule(const std::string& cron, const std::string& action) {
+    json request = {
+        {"action", "set_schedule"},
+        {"token", token},
+        {"clientId", clientId},
+        {"cron", cron},
+        {"timer_action", action}
+    };
+
+    try {
+        json response = sendRequest(request);
+        if (response["status"] != 200) {
+            throw std::runtime_error(response["message"]);
+        }
+        return response.value("timer_id", static_cast<int64_t>(-1));
+    } catch (const std::exception& e) {
+        std::cerr << "Error setting schedule: " << e.what() << std::endl;
+    }
+    return -1;
+}
+
+nlohmann::json DeviceProxy::listTimers() {
+    json request = {
+        {"action", "list_timers"},
+        {"token", token},
+        {"clientId", clientId}
+    };
+
+    try {
+        json response = sendRequest(request);
+        if (response["status"] != 200) {
+            throw std::runtime_error(response["message"]);
+        }
+        return response.value("timers", json::array());
+    } catch (const std::exception& e) {
+        std::cerr << "Error listing timers: " << e.what() << std::endl;
+    }
+    return json::array();
+}
+
+bool DeviceProxy::cancelTimer(int64_t timerId) {
+    json request = {
+        {"action", "cancel_timer"},
+        {"token", token},
+        {"clientId", clientId},
+        {"timer_id", timerId}
+    };
+
+    try {
+        json response = sendRequest(request);
+        if (response["status"] != 200) {
+            throw std::runtime_error(response["message"]);
+        }
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error canceling timer: " << e.what() << std::endl;
+    }
+    return false;
+}
+
+bool DeviceProxy::cancelAllTimers() {
+    json request = {
+        {"action", "cancel_timers"},
+        {"token", token},
+        {"clientId", clientId}
+    };
+
+    try {
+        json response = sendRequest(request);
+        if (response["status"] != 200) {
+            throw std::runtime_error(response["message"]);
+        }
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error canceling timers: " << e.what() << std::endl;
+    }
+    return false;
 }
 
 nlohmann::json DeviceProxy::getInfo() {
@@ -0,0 +1,34 @@
+#include "../include/DeviceProxyFactory.h"
+#include "../include/ACProxy.h"
+#include "../include/LightProxy.h"
+#include "../include/FanProxy.h"
+
+DeviceProxyFactory::DeviceProxyFactory() {
+    registerType("AC", [](const std::string& id, const std::string& ipAddress, const std::string& clientId, int port) {
+        return std::make_shared<ACProxy>(id, ipAddress, clientId, port);
+    });
+    registerType("Light", [](const std::string& id, const std::string& ipAddress, const std::string& clientId, int port) {
+        return std::make_shared<LightProxy>(id, ipAddress, clientId, port);
+    });
+    registerType("Fan", [](const std::string& id, const std::string& ipAddress, const std::string& clientId, int port) {
+        return std::make_shared<FanProxy>(id, ipAddress, clientId, port);
+    });
+}
+
+DeviceProxyFactory& DeviceProxyFactory::getInstance() {
+    static DeviceProxyFactory instance;
+    return instance;
+}
+
+void DeviceProxyFactory::registerType(const std::string& type, Creator creator) {
+    creators[type] = std::move(creator);
+}
+
+std::shared_ptr<DeviceProxy> DeviceProxyFactory::create(const std::string& type, const std::string& id, const std::string& ipAddress,
+                                                        const std::string& clientId, int port) const {
+    auto it = creators.find(type);
+    if (it != creators.end()) {
+        return it->second(id, ipAddress, clientId, port);
+    }
+    return std::make_shared<DeviceProxy>(id, type, ipAddress, clientId, port);
+}
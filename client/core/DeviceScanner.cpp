@@ -2,18 +2,29 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <sys/eventfd.h>
 #include <unistd.h>
+#include <poll.h>
 #include <thread>
 #include <stdexcept>
 #include <iostream>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <algorithm>
 
 using json = nlohmann::json;
 
 DeviceScanner::DeviceScanner(const std::string& multicastIP, int multicastPort)
-    : multicastIP(multicastIP), multicastPort(multicastPort), socket(-1), stopFlag(false) {}
+    : multicastIP(multicastIP), multicastPort(multicastPort) {
+    wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+}
 
 DeviceScanner::~DeviceScanner() {
     stopScan();
+    if (wakeFd >= 0) {
+        close(wakeFd);
+    }
 }
 
 DeviceScanner& DeviceScanner::getInstance() {
@@ -22,29 +33,75 @@ DeviceScanner& DeviceScanner::getInstance() {
 }
 
 void DeviceScanner::startScan() {
-    if (socket != -1) {
+    if (running) {
         throw std::runtime_error("Socket is already in use. Stop the current scan before starting a new one.");
     }
 
-    clearLastError();  
-    stopFlag = false;
-    scannedDevices.clear();
+    {
+        std::lock_guard<std::mutex> lock(deviceMutex);
+        scannedDevices.clear();
+        addressById.clear();
+        registryChanged = true;
+    }
+    publishSnapshot();
+    continuous = false;
+    startListener();
+}
 
-    std::thread(&DeviceScanner::listenForDevices, this).detach();
+void DeviceScanner::startContinuousDiscovery() {
+    if (running) return;
+    continuous = true;
+    startListener();
+}
+
+bool DeviceScanner::isContinuous() const {
+    return continuous && running;
+}
+
+void DeviceScanner::startListener() {
+    if (listener.joinable()) {
+        listener.join(); // A listener that stopped on an error
+    }
+    clearLastError();
+    stopFlag = false;
+    running = true;
+    listener = std::thread(&DeviceScanner::listenForDevices, this);
 }
 
 void DeviceScanner::stopScan() {
     stopFlag = true;
-    if (socket != -1) {
-        closeSocket();
-        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    uint64_t one = 1;
+    if (wakeFd >= 0 && write(wakeFd, &one, sizeof(one)) < 0) {
+        // Already signalled
+    }
+    if (listener.joinable()) {
+        listener.join();
+    }
+    uint64_t count;
+    if (wakeFd >= 0 && read(wakeFd, &count, sizeof(count)) < 0) {
+        // Nothing pending
     }
+    continuous = false;
 }
 
+// FNV-1a over the whole datagram
+static uint64_t datagramHash(const char* data, size_t size) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ static_cast<uint8_t>(data[i])) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Waits on the socket and the wakeup eventfd. Each wakeup takes up to
+// RECEIVE_BATCH datagrams with one recvmmsg call, applies them all and
+// publishes at most one snapshot, so thousands of beacons per second cost a
+// handful of system calls and no allocations beyond the records themselves.
 void DeviceScanner::listenForDevices() {
+    int sock = -1;
     try {
-        socket = ::socket(AF_INET, SOCK_DGRAM, 0);
-        if (socket < 0) {
+        sock = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (sock < 0) {
             throw std::runtime_error("Failed to create socket");
         }
 
@@ -53,7 +110,7 @@ void DeviceScanner::listenForDevices() {
         localAddr.sin_port = htons(multicastPort);
         localAddr.sin_addr.s_addr = htonl(INADDR_ANY);
 
-        if (bind(socket, (struct sockaddr*)&localAddr, sizeof(localAddr)) < 0) {
+        if (bind(sock, (struct sockaddr*)&localAddr, sizeof(localAddr)) < 0) {
             throw std::runtime_error("Failed to bind socket");
         }
 
@@ -61,78 +118,301 @@ void DeviceScanner::listenForDevices() {
         inet_pton(AF_INET, multicastIP.c_str(), &mreq.imr_multiaddr);
         mreq.imr_interface.s_addr = htonl(INADDR_ANY);
 
-        if (setsockopt(socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+        if (setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
             throw std::runtime_error("Failed to join multicast group");
         }
 
-        char buffer[1024];
+        // Ask every device to announce itself now instead of waiting for its
+        // next beacon; replies arrive within about 100 ms
+        sockaddr_in groupAddr{};
+        groupAddr.sin_family = AF_INET;
+        groupAddr.sin_port = htons(multicastPort + 1); // Devices listen for queries on the next port
+        groupAddr.sin_addr = mreq.imr_multiaddr;
+        std::string query = json{{"action", "discover"}}.dump();
+        if (sendto(sock, query.data(), query.size(), 0, (struct sockaddr*)&groupAddr, sizeof(groupAddr)) < 0) {
+            std::cerr << "Failed to send discovery query; waiting for beacons" << std::endl;
+        }
+
+        receiveBuffer.resize(RECEIVE_BATCH * RECEIVE_SLOT);
+        mmsghdr messages[RECEIVE_BATCH];
+        iovec slots[RECEIVE_BATCH];
+        for (int i = 0; i < RECEIVE_BATCH; ++i) {
+            slots[i] = {receiveBuffer.data() + i * RECEIVE_SLOT, RECEIVE_SLOT};
+        }
+
         while (!stopFlag) {
-            ssize_t bytesRead = recv(socket, buffer, sizeof(buffer) - 1, 0);
-            if (bytesRead > 0) {
-                buffer[bytesRead] = '\0';
-                try {
-                    json deviceInfo = json::parse(buffer);
-                    if (validateDeviceInfo(deviceInfo) && !isDeviceAlreadyScanned(deviceInfo)) {
-                        std::lock_guard<std::mutex> lock(deviceMutex);
-                        scannedDevices.push_back(deviceInfo);
+            // Wake up once a second to drop expired devices even when nothing arrives
+            pollfd fds[2] = {{sock, POLLIN, 0}, {wakeFd, POLLIN, 0}};
+            int ready = poll(fds, 2, 1000);
+            if (ready < 0 && errno != EINTR) {
+                throw std::runtime_error("Failed to wait for announcements");
+            }
+            if (ready > 0 && (fds[0].revents & POLLIN)) {
+                std::memset(messages, 0, sizeof(messages));
+                for (int i = 0; i < RECEIVE_BATCH; ++i) {
+                    messages[i].msg_hdr.msg_iov = &slots[i];
+                    messages[i].msg_hdr.msg_iovlen = 1;
+                }
+                int received = recvmmsg(sock, messages, RECEIVE_BATCH, MSG_DONTWAIT, nullptr);
+                for (int i = 0; i < received; ++i) {
+                    // Truncated datagrams are not from a device
+                    if (messages[i].msg_hdr.msg_flags & MSG_TRUNC) continue;
+                    const char* data = receiveBuffer.data() + i * RECEIVE_SLOT;
+                    uint64_t hash = datagramHash(data, messages[i].msg_len);
+                    if (refreshRepeated(hash)) continue;
+                    if (parseAnnouncement(data, messages[i].msg_len, announcement)) {
+                        updateScannedDevices(announcement);
+                        rememberRepeated(hash, announcement);
+                    } else {
+                        std::cerr << "Failed to parse device info" << std::endl;
                     }
-                } catch (const json::exception& e) {
-                    std::cerr << "Failed to parse device info: " << e.what() << std::endl;
                 }
             }
+            expireScannedDevices(Clock::now());
+            publishSnapshot();
         }
-
-        close(socket);
-        socket = -1;
-
     } catch (const std::exception& e) {
-        {
-            std::lock_guard<std::mutex> lock(errorMutex);
-            lastError = e.what();
-        }
-        stopFlag = true;
-        closeSocket();
+        std::lock_guard<std::mutex> lock(errorMutex);
+        lastError = e.what();
     }
+    if (sock >= 0) {
+        close(sock);
+    }
+    running = false;
 }
 
 
-bool DeviceScanner::isDeviceAlreadyScanned(const json& deviceInfo) const {
-    std::lock_guard<std::mutex> lock(deviceMutex); // Đồng bộ hóa khi đọc danh sách thiết bị
-    auto it = std::find_if(scannedDevices.begin(), scannedDevices.end(), [&](const json& device) {
-        return device["id"] == deviceInfo["id"] && device["ipAddress"] == deviceInfo["ipAddress"];
-    });
-    return it != scannedDevices.end();
+// Refreshes the devices of a datagram seen before. False if it is new or one
+// of its devices is gone meanwhile, in which case it must be parsed again.
+bool DeviceScanner::refreshRepeated(uint64_t hash) {
+    auto cached = repeatedDatagrams.find(hash);
+    if (cached == repeatedDatagrams.end()) return false;
+    auto now = Clock::now();
+    auto expiresAt = cached->second.ttl > 0 ? now + std::chrono::seconds(cached->second.ttl) : Clock::time_point::max();
+    std::lock_guard<std::mutex> lock(deviceMutex);
+    for (const auto& key : cached->second.keys) {
+        auto it = scannedDevices.find(key);
+        if (it == scannedDevices.end()) return false;
+        it->second.lastSeen = now;
+        it->second.expiresAt = expiresAt;
+    }
+    return true;
 }
 
-std::vector<json> DeviceScanner::getScannedDevices() const {
-    std::lock_guard<std::mutex> lock(deviceMutex); 
-    return scannedDevices; // Trả về bản sao
+void DeviceScanner::rememberRepeated(uint64_t hash, const Announcement& announcement) {
+    if (announcement.byebye) return;
+    if (repeatedDatagrams.size() >= MAX_REPEATED) {
+        repeatedDatagrams.clear();
+    }
+    RepeatedDatagram& cached = repeatedDatagrams[hash];
+    cached.ttl = announcement.ttl;
+    cached.keys.clear();
+    for (const auto& device : announcement.devices) {
+        cached.keys.push_back({device.id, device.ipAddress});
+    }
 }
 
+// Adds new devices and refreshes known ones in place, or removes them on
+// byebye. A known ID announced from a new address with the same type and
+// port is taken to have moved: its record is re-keyed rather than duplicated.
+void DeviceScanner::updateScannedDevices(const Announcement& announcement) {
+    auto now = Clock::now();
+    // Devices without a ttl never expire
+    auto expiresAt = announcement.ttl > 0 ? now + std::chrono::seconds(announcement.ttl) : Clock::time_point::max();
+    DeviceKey key;
 
-bool DeviceScanner::validateDeviceInfo(const json& deviceInfo) const {
-    if (!deviceInfo.contains("type") || !deviceInfo["type"].is_string()) {
-        return false;
+    std::lock_guard<std::mutex> lock(deviceMutex);
+    for (const auto& device : announcement.devices) {
+        key.id = device.id;
+        key.ipAddress = device.ipAddress;
+        auto it = scannedDevices.find(key);
+        if (announcement.byebye) {
+            if (it == scannedDevices.end()) continue;
+            scannedDevices.erase(it);
+            registryChanged = true;
+            auto latest = addressById.find(device.id);
+            if (latest != addressById.end() && latest->second == device.ipAddress) addressById.erase(latest);
+            continue;
+        }
+
+        if (it == scannedDevices.end()) {
+            auto latest = addressById.find(device.id);
+            if (latest != addressById.end() && latest->second != device.ipAddress) {
+                auto previous = scannedDevices.find(DeviceKey{device.id, latest->second});
+                if (previous != scannedDevices.end() && previous->second.port == device.port &&
+                    previous->second.type == device.type) {
+                    auto node = scannedDevices.extract(previous);
+                    node.key().ipAddress = device.ipAddress;
+                    it = scannedDevices.insert(std::move(node)).position;
+                    registryChanged = true;
+                }
+            }
+        }
+        if (it == scannedDevices.end()) {
+            it = scannedDevices.emplace(key, device).first;
+            registryChanged = true;
+        }
+        ScannedDevice& record = it->second;
+        if (record.ipAddress != device.ipAddress || record.type != device.type || record.port != device.port) {
+            registryChanged = true;
+        }
+        record.ipAddress = device.ipAddress;
+        record.type = device.type;
+        record.port = device.port;
+        record.lastSeen = now;
+        record.expiresAt = expiresAt;
+        addressById[device.id] = device.ipAddress;
     }
-    if (!deviceInfo.contains("id") || !deviceInfo["id"].is_string()) {
-        return false;
+}
+
+// Drops devices whose ttl ran out; a full sweep at most once per second keeps
+// the per-packet cost constant
+void DeviceScanner::expireScannedDevices(Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(deviceMutex);
+    if (now < nextExpirySweep) return;
+    nextExpirySweep = now + std::chrono::seconds(1);
+    for (auto it = scannedDevices.begin(); it != scannedDevices.end();) {
+        if (it->second.expiresAt > now) {
+            ++it;
+            continue;
+        }
+        auto latest = addressById.find(it->first.id);
+        if (latest != addressById.end() && latest->second == it->first.ipAddress) addressById.erase(latest);
+        it = scannedDevices.erase(it);
+        registryChanged = true;
     }
-    if (!deviceInfo.contains("ipAddress") || !deviceInfo["ipAddress"].is_string()) {
-        return false;
+}
+
+// Copies the registry into a fresh snapshot and swaps it in. Readers keep
+// whatever snapshot they already hold; the last one to let go frees it.
+void DeviceScanner::publishSnapshot() {
+    auto devices = std::make_shared<std::vector<ScannedDevice>>();
+    {
+        std::lock_guard<std::mutex> lock(deviceMutex);
+        if (!registryChanged) return;
+        registryChanged = false;
+        devices->reserve(scannedDevices.size());
+        for (const auto& entry : scannedDevices) {
+            devices->push_back(entry.second);
+        }
+        std::atomic_store(&snapshot, Snapshot(std::move(devices)));
+    }
+    generation.fetch_add(1, std::memory_order_release);
+}
+
+// The announcement formats are specified once, in the device's
+// include/DiscoveryService.h; DiscoveryService::decode reads the same input,
+// and device/tests/DiscoveryFormatTest checks the two against each other.
+static bool parseBinaryAnnouncement(const uint8_t* pos, const uint8_t* end, DeviceScanner::Announcement& announcement) {
+    pos += 4;
+    if (end - pos < 8) return false;
+    announcement.byebye = (pos[0] & 0x01) != 0;
+    announcement.ttl = pos[1] | (pos[2] << 8);
+    pos += 3;
+    char ipText[INET_ADDRSTRLEN];
+    in_addr address{};
+    std::memcpy(&address, pos, 4);
+    pos += 4;
+    if (!inet_ntop(AF_INET, &address, ipText, sizeof(ipText))) return false;
+
+    std::vector<std::string> typeNames(*pos++);
+    for (auto& name : typeNames) {
+        if (pos >= end || end - pos - 1 < *pos) return false;
+        name.assign(reinterpret_cast<const char*>(pos + 1), *pos);
+        pos += 1 + *pos;
     }
-    if (!deviceInfo.contains("port") || !deviceInfo["port"].is_number_integer()) {
+    if (end - pos < 2) return false;
+    uint16_t count = static_cast<uint16_t>(pos[0] | (pos[1] << 8));
+    pos += 2;
+
+    const std::string* previousId = nullptr;
+    int64_t previousPort = 0;
+    for (uint16_t i = 0; i < count; ++i) {
+        if (end - pos < 3) return false;
+        uint8_t type = pos[0], shared = pos[1], rest = pos[2];
+        pos += 3;
+        if (type >= typeNames.size() || shared > (previousId ? previousId->size() : 0) || end - pos < rest) return false;
+        DeviceScanner::ScannedDevice device;
+        if (previousId) device.id.assign(*previousId, 0, shared);
+        device.id.append(reinterpret_cast<const char*>(pos), rest);
+        pos += rest;
+
+        uint64_t zigzag = 0;
+        int shift = 0;
+        while (true) {
+            if (pos >= end || shift >= 64) return false;
+            uint8_t byte = *pos++;
+            zigzag |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) break;
+            shift += 7;
+        }
+        int64_t port = previousPort + (static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1));
+
+        device.type = typeNames[type];
+        device.ipAddress = ipText;
+        device.port = static_cast<int>(port);
+        announcement.devices.push_back(std::move(device));
+        previousId = &announcement.devices.back().id;
+        previousPort = port;
+    }
+    return pos == end;
+}
+
+// Reads one JSON device record; the address is the message's
+static bool parseDeviceRecord(const json& record, const json& message, DeviceScanner::ScannedDevice& device) {
+    const json& address = message["ipAddress"];
+    if (!record.is_object() || !address.is_string() ||
+        !record.contains("type") || !record["type"].is_string() ||
+        !record.contains("id") || !record["id"].is_string() ||
+        !record.contains("port") || !record["port"].is_number_integer()) {
         return false;
     }
+    device.id = record["id"];
+    device.type = record["type"];
+    device.ipAddress = address;
+    device.port = record["port"];
     return true;
 }
 
-void DeviceScanner::closeSocket() {
-    if (socket != -1) {
-        close(socket);
-        socket = -1;
+bool DeviceScanner::parseAnnouncement(const char* data, size_t size, Announcement& announcement) {
+    announcement.ttl = 0;
+    announcement.byebye = false;
+    announcement.devices.clear();
+    if (size >= 4 && std::memcmp(data, "DSC2", 4) == 0) {
+        const auto* bytes = reinterpret_cast<const uint8_t*>(data);
+        return parseBinaryAnnouncement(bytes, bytes + size, announcement);
+    }
+    try {
+        json message = json::parse(data, data + size);
+        if (!message.is_object() || !message.contains("ipAddress")) return false;
+        if (message.contains("ttl") && message["ttl"].is_number_integer()) announcement.ttl = message["ttl"];
+        announcement.byebye = message.contains("action") && message["action"] == "byebye";
+        ScannedDevice device;
+        if (!message.contains("devices")) {
+            if (!parseDeviceRecord(message, message, device)) return false;
+            announcement.devices.push_back(std::move(device));
+            return true;
+        }
+        // Aggregated: one host address and ttl for all records
+        if (!message["devices"].is_array()) return false;
+        for (const auto& record : message["devices"]) {
+            if (!record.is_object() || !parseDeviceRecord(record, message, device)) return false;
+            announcement.devices.push_back(std::move(device));
+        }
+        return true;
+    } catch (const json::exception&) {
+        return false;
     }
 }
 
+uint64_t DeviceScanner::getGeneration() const {
+    return generation.load(std::memory_order_acquire);
+}
+
+DeviceScanner::Snapshot DeviceScanner::getScannedDevices() const {
+    return std::atomic_load(&snapshot);
+}
+
 std::string DeviceScanner::getLastError() const {
     std::lock_guard<std::mutex> lock(errorMutex);
     return lastError;
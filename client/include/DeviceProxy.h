@@ -2,6 +2,7 @@
 #define DEVICE_PROXY_H
 
 #include <string>
+#include <cstdint>
 #include "../lib/json.hpp"
 
 class DeviceProxy {
@@ -32,7 +33,12 @@ public:
     bool isAuthenticated() const;
     void turnOn();
     void turnOff();
-    void setTimer(int duration, const std::string& action);
+    int64_t setTimer(int duration, const std::string& action); // Returns timer ID, or -1 on failure
+    int64_t setIntervalSchedule(int intervalSeconds, const std::string& action); // Recurring every N seconds
+    int64_t setCronSchedule(const std::string& cron, const std::string& action);  // e.g. "0 18 * * 1-5"
+    nlohmann::json listTimers();                                // Pending timers, earliest first
+    bool cancelTimer(int64_t timerId);
+    bool cancelAllTimers();
     void markUnreachable() { 
         deviceReachable = false;
         token.clear();
@@ -46,6 +52,8 @@ public:
 
     std::string getId() const { return id; }
     std::string getType() const { return type; }
+    std::string getIpAddress() const { return ipAddress; }
+    int getPort() const { return port; }
     std::string getClientId() const { return clientId; }
     bool changePassword(const std::string& currentPassword, const std::string& newPassword);
 };
@@ -0,0 +1,30 @@
+#ifndef DEVICE_PROXY_FACTORY_H
+#define DEVICE_PROXY_FACTORY_H
+
+#include <string>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include "DeviceProxy.h"
+
+// Creates the proxy for a discovered device from its advertised type.
+// Types without a dedicated proxy (e.g. ones added by device plugins) get a
+// plain DeviceProxy, which still supports power, timers and details.
+class DeviceProxyFactory {
+public:
+    using Creator = std::function<std::shared_ptr<DeviceProxy>(const std::string& id, const std::string& ipAddress,
+                                                               const std::string& clientId, int port)>;
+
+    static DeviceProxyFactory& getInstance();
+
+    void registerType(const std::string& type, Creator creator);
+    std::shared_ptr<DeviceProxy> create(const std::string& type, const std::string& id, const std::string& ipAddress,
+                                        const std::string& clientId, int port) const;
+
+private:
+    DeviceProxyFactory(); // Registers the built-in proxies
+
+    std::unordered_map<std::string, Creator> creators; // Keyed by advertised type, e.g. "Fan"
+};
+
+#endif
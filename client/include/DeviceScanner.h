@@ -4,29 +4,120 @@
 #include <vector>
 #include <string>
 #include <mutex>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <functional>
+#include <unordered_map>
 #include "../lib/json.hpp"
 
 class DeviceScanner {
 public:
+    using Clock = std::chrono::steady_clock;
+
+    // One device seen on the network
+    struct ScannedDevice {
+        std::string id;
+        std::string type;
+        std::string ipAddress;
+        int port = 0;
+        Clock::time_point lastSeen;
+        Clock::time_point expiresAt; // Dropped unless re-announced by then
+    };
+
+    // One decoded announcement datagram
+    struct Announcement {
+        int ttl = 0;         // Seconds; 0 if the sender gave none (never expires)
+        bool byebye = false; // The devices are leaving
+        std::vector<ScannedDevice> devices;
+    };
+
     static DeviceScanner& getInstance();
+    // A scan clears the results, queries the network and listens until stopped
     void startScan();
+    // Always-on discovery: keeps the results and follows beacons, byebyes and
+    // expiries in the background. Does nothing if already listening.
+    void startContinuousDiscovery();
+    bool isContinuous() const;
+    // Stops either mode and joins the listener thread
     void stopScan();
-    std::vector<nlohmann::json> getScannedDevices() const; // Trả về danh sách thiết bị quét được
+    using Snapshot = std::shared_ptr<const std::vector<ScannedDevice>>;
+
+    // Scan results are published as immutable snapshots. The generation
+    // changes whenever a device appears, disappears or changes its address
+    // or port, so consumers can poll it every frame and only fetch and walk
+    // the snapshot when it moved. Re-announcements alone do not publish, so
+    // lastSeen and expiresAt are as of the snapshot.
+    uint64_t getGeneration() const;
+    Snapshot getScannedDevices() const; // Trả về danh sách thiết bị quét được; never null
     std::string getLastError() const; // Getter for the last error
     void clearLastError();           // Clear the last error
 
+    // Unpacks one announcement datagram (single device, aggregated JSON or
+    // binary "DSC2", as specified in the device's DiscoveryService.h); false
+    // if it is not a valid announcement
+    static bool parseAnnouncement(const char* data, size_t size, Announcement& announcement);
 
 private:
+    // Registry key; the same ID at two addresses is two devices unless the
+    // announcement is a move (see updateScannedDevices)
+    struct DeviceKey {
+        std::string id;
+        std::string ipAddress;
+        bool operator==(const DeviceKey& other) const { return id == other.id && ipAddress == other.ipAddress; }
+    };
+    struct DeviceKeyHash {
+        size_t operator()(const DeviceKey& key) const {
+            size_t h = std::hash<std::string>()(key.id);
+            return h ^ (std::hash<std::string>()(key.ipAddress) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2));
+        }
+    };
+
     DeviceScanner(const std::string& multicastIP, int multicastPort);
+    DeviceScanner(const DeviceScanner&) = delete;
+    DeviceScanner& operator=(const DeviceScanner&) = delete;
     ~DeviceScanner();
+    void startListener();
     void listenForDevices(); // Luồng xử lý quét thiết bị
-    bool validateDeviceInfo(const nlohmann::json& deviceInfo) const; // Kiểm tra thông tin thiết bị hợp lệ
-    bool isDeviceAlreadyScanned(const nlohmann::json& deviceInfo) const; // Kiểm tra trùng lặp thiết bị
-    void closeSocket();
-    
-    int socket;
-    bool stopFlag;
-    std::vector<nlohmann::json> scannedDevices;
+    void updateScannedDevices(const Announcement& announcement);
+    bool refreshRepeated(uint64_t hash);
+    void rememberRepeated(uint64_t hash, const Announcement& announcement);
+    void expireScannedDevices(Clock::time_point now);
+    void publishSnapshot();
+
+    // Only the caller of start/stop touches these; the socket belongs to the listener thread
+    std::thread listener;
+    bool continuous = false;
+    int wakeFd = -1;                  // eventfd; wakes the listener to stop
+    std::atomic<bool> stopFlag{false};
+    std::atomic<bool> running{false}; // Cleared when the listener exits, also on error
+
+    // Receive buffers and the decoded announcement, reused across batches and runs
+    static constexpr int RECEIVE_BATCH = 32;
+    static constexpr size_t RECEIVE_SLOT = 9000; // Jumbo frame; announcements are at most 1400 bytes
+    std::vector<char> receiveBuffer;
+    Announcement announcement;
+
+    // Devices re-send identical datagrams until something changes, so the
+    // listener remembers which devices each datagram (by content hash) held
+    // and refreshes them without parsing it again
+    struct RepeatedDatagram {
+        int ttl = 0;
+        std::vector<DeviceKey> keys;
+    };
+    static constexpr size_t MAX_REPEATED = 4096;
+    std::unordered_map<uint64_t, RepeatedDatagram> repeatedDatagrams; // Listener thread only
+
+    // Guarded by deviceMutex. Each packet costs one hash lookup per record;
+    // expired devices are swept at most once per second.
+    std::unordered_map<DeviceKey, ScannedDevice, DeviceKeyHash> scannedDevices;
+    std::unordered_map<std::string, std::string> addressById; // Latest address of each ID
+    Clock::time_point nextExpirySweep;
+    bool registryChanged = false; // Not yet in the published snapshot
+    // Swapped with std::atomic_store, read with std::atomic_load
+    Snapshot snapshot = std::make_shared<const std::vector<ScannedDevice>>();
+    std::atomic<uint64_t> generation{0};
     mutable std::mutex deviceMutex; // Mutex để đồng bộ hóa truy cập vào scannedDevices
     mutable std::mutex errorMutex;   // Mutex to protect error messages
     std::string lastError;           // To store the last error message
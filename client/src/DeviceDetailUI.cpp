@@ -179,6 +179,44 @@ void renderCachedDetails(DeviceProxy& device, nlohmann::json& cachedDetails, boo
     ImGui::Separator();
 }
 
+// Hàm hiển thị danh sách timer đang chờ, cho phép hủy từng timer hoặc tất cả
+void renderPendingTimers(DeviceProxy& device, nlohmann::json& pendingTimers, bool& refreshRequested) {
+    ImGui::Text("Pending Timers:");
+    ImGui::SameLine();
+    if (ImGui::Button("Refresh Timers")) {
+        refreshRequested = true;
+    }
+
+    if (refreshRequested) {
+        pendingTimers = device.listTimers();
+        refreshRequested = false;
+    }
+
+    if (pendingTimers.empty()) {
+        ImGui::Text("No pending timers.");
+    } else {
+        for (const auto& timer : pendingTimers) {
+            int64_t timerId = timer.value("id", static_cast<int64_t>(-1));
+            std::string action = timer.value("action", std::string("unknown"));
+            int remaining = timer.value("remaining", 0);
+            std::string schedule = timer.value("schedule", std::string("once"));
+
+            ImGui::Text("#%lld %s in %d s (%s)", static_cast<long long>(timerId), action.c_str(), remaining, schedule.c_str());
+            ImGui::SameLine();
+            if (ImGui::Button(("Cancel##Timer" + std::to_string(timerId)).c_str())) {
+                device.cancelTimer(timerId);
+                refreshRequested = true;
+            }
+        }
+
+        if (ImGui::Button("Cancel All Timers", ImVec2(150, 30))) {
+            device.cancelAllTimers();
+            refreshRequested = true;
+        }
+    }
+    ImGui::Separator();
+}
+
 // Hàm hiển thị các hành động chung (Turn On, Turn Off, Set Timer)
 void renderCommonActions(DeviceProxy& device) {
     ImGui::Text("Actions:");
@@ -201,9 +239,38 @@ void renderCommonActions(DeviceProxy& device) {
     ImGui::SliderInt("Duration (s)", &timerDuration, 1, 20);
     ImGui::Combo("Action", &timerAction, actions, IM_ARRAYSIZE(actions));
 
+    static nlohmann::json pendingTimers = nlohmann::json::array();
+    static bool timersRefreshRequested = true;
+    static std::string timersDeviceId;
+
+    // Timer IDs are per device; never show or cancel another device's timers
+    if (timersDeviceId != device.getId()) {
+        timersDeviceId = device.getId();
+        pendingTimers = nlohmann::json::array();
+        timersRefreshRequested = true;
+    }
+
     if (ImGui::Button("Set Timer", ImVec2(150, 30))) {
         device.setTimer(timerDuration, (timerAction == 0 ? "turn_on" : "turn_off"));
+        timersRefreshRequested = true;
+    }
+
+    // Recurring Schedule Section
+    ImGui::Text("Recurring Schedule:");
+    static char cronExpression[64] = "0 18 * * 1-5";
+    static int scheduleInterval = 3600;
+    ImGui::InputText("Cron (min hour day month weekday)", cronExpression, IM_ARRAYSIZE(cronExpression));
+    if (ImGui::Button("Set Cron Schedule", ImVec2(200, 30))) {
+        device.setCronSchedule(cronExpression, (timerAction == 0 ? "turn_on" : "turn_off"));
+        timersRefreshRequested = true;
     }
+    ImGui::InputInt("Interval (s)", &scheduleInterval);
+    if (ImGui::Button("Set Interval Schedule", ImVec2(200, 30)) && scheduleInterval > 0) {
+        device.setIntervalSchedule(scheduleInterval, (timerAction == 0 ? "turn_on" : "turn_off"));
+        timersRefreshRequested = true;
+    }
+
+    renderPendingTimers(device, pendingTimers, timersRefreshRequested);
 
     renderChangePassword(device);
 }
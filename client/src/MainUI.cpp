@@ -1,18 +1,32 @@
 #include "../include/DeviceScanner.h"
 #include "DeviceDetailUI.h"
 #include "../include/DeviceProxy.h"
-#include "../include/ACProxy.h"
-#include "../include/LightProxy.h"
+#include "../include/DeviceProxyFactory.h"
 #include "../include/HomeManager.h"
-#include "../include/FanProxy.h"
 #include "../lib/imgui/imgui.h"
 #include <vector>
 #include <string>
 #include <iostream>
+#include <algorithm>
+#include <unordered_set>
+#include <unordered_map>
 
 // Hàm xử lý quét thiết bị
 void handleDeviceScanning(bool& scanningInProgress, std::vector<std::shared_ptr<DeviceProxy>>& devices, std::string& clientId, std::string& errorMsg) {
-    if (!scanningInProgress && ImGui::Button("Scan Devices")) {
+    // Continuous discovery keeps the device list current in the background
+    static bool continuousDiscovery = false;
+    if (!scanningInProgress && ImGui::Checkbox("Continuous Discovery", &continuousDiscovery)) {
+        if (continuousDiscovery) {
+            DeviceScanner::getInstance().startContinuousDiscovery();
+        } else {
+            DeviceScanner::getInstance().stopScan();
+        }
+    }
+    if (continuousDiscovery && !DeviceScanner::getInstance().isContinuous()) {
+        continuousDiscovery = false; // Stopped on an error
+    }
+
+    if (!scanningInProgress && !continuousDiscovery && ImGui::Button("Scan Devices")) {
         try {
             scanningInProgress = true;
             errorMsg.clear();
@@ -29,35 +43,39 @@ void handleDeviceScanning(bool& scanningInProgress, std::vector<std::shared_ptr<
         DeviceScanner::getInstance().stopScan();
     }
 
-    if (!scanningInProgress && !DeviceScanner::getInstance().getLastError().empty()) {
+    if (!scanningInProgress && !continuousDiscovery && !DeviceScanner::getInstance().getLastError().empty()) {
         errorMsg = DeviceScanner::getInstance().getLastError();
         DeviceScanner::getInstance().clearLastError();
     }
 
-    if (scanningInProgress) {
+    // Only rework the proxy list when the scan results changed
+    static uint64_t seenGeneration = 0;
+    if ((scanningInProgress || continuousDiscovery) && DeviceScanner::getInstance().getGeneration() != seenGeneration) {
         try {
+            seenGeneration = DeviceScanner::getInstance().getGeneration();
             auto scannedDevices = DeviceScanner::getInstance().getScannedDevices();
-            for (const auto& device : scannedDevices) {
-                bool deviceAlreadyAdded = false;
-
-                for (const auto& existingDevice : devices) {
-                    if (existingDevice->getId() == device["id"].get<std::string>()) {
-                        deviceAlreadyAdded = true;
-                        break;
-                    }
+            std::unordered_map<std::string, const DeviceScanner::ScannedDevice*> scannedById;
+            for (const auto& device : *scannedDevices) {
+                scannedById.emplace(device.id, &device);
+            }
+            // Devices that said goodbye or stopped announcing become unavailable;
+            // one that moved to a new address or port gets a fresh proxy
+            devices.erase(std::remove_if(devices.begin(), devices.end(), [&](const std::shared_ptr<DeviceProxy>& existingDevice) {
+                return !scannedById.count(existingDevice->getId());
+            }), devices.end());
+            std::unordered_set<std::string> knownIds;
+            for (auto& existingDevice : devices) {
+                const auto& device = *scannedById[existingDevice->getId()];
+                if (existingDevice->getIpAddress() != device.ipAddress || existingDevice->getPort() != device.port) {
+                    existingDevice = DeviceProxyFactory::getInstance().create(
+                        device.type, device.id, device.ipAddress, clientId, device.port);
                 }
-
-                if (!deviceAlreadyAdded) {
-                    std::string type = device["type"].get<std::string>();
-                    if (type == "AC") {
-                        devices.push_back(std::make_shared<ACProxy>(device["id"], device["ipAddress"], clientId, device["port"]));
-                    } else if (type == "Light") {
-                        devices.push_back(std::make_shared<LightProxy>(device["id"], device["ipAddress"], clientId, device["port"]));
-                    } else if (type == "Fan") {
-                        devices.push_back(std::make_shared<FanProxy>(device["id"], device["ipAddress"], clientId, device["port"]));
-                    } else {
-                        std::cerr << "Unknown device type: " << type << std::endl;
-                    }
+                knownIds.insert(device.id);
+            }
+            for (const auto& device : *scannedDevices) {
+                if (knownIds.insert(device.id).second) {
+                    devices.push_back(DeviceProxyFactory::getInstance().create(
+                        device.type, device.id, device.ipAddress, clientId, device.port));
                 }
             }
         } catch (const std::exception& e) {
@@ -34,7 +34,7 @@ void printModes() {
 
 int main() {
     auto& scanner = DeviceScanner::getInstance();
-    std::vector<json> devices;
+    std::vector<DeviceScanner::ScannedDevice> devices;
     std::shared_ptr<ACProxy> acDevice = nullptr; // Shared pointer to maintain device state
 
     std::cout << "Welcome to the CLI Smart Home Controller\n";
@@ -48,13 +48,14 @@ int main() {
             case 1: { // Scan for devices
                 std::cout << "Scanning for devices...\n";
                 scanner.startScan();
-                std::this_thread::sleep_for(std::chrono::seconds(5));
+                std::this_thread::sleep_for(std::chrono::milliseconds(300)); // Devices answer the scan query within ~100 ms
                 scanner.stopScan();
-                devices = scanner.getScannedDevices();
+                devices = *scanner.getScannedDevices();
 
                 std::cout << "Devices found:\n";
                 for (size_t i = 0; i < devices.size(); ++i) {
-                    std::cout << i + 1 << ". " << devices[i].dump(4) << std::endl;
+                    std::cout << i + 1 << ". " << devices[i].type << " " << devices[i].id << " at "
+                              << devices[i].ipAddress << ":" << devices[i].port << std::endl;
                 }
                 break;
             }
@@ -72,8 +73,8 @@ int main() {
                     break;
                 }
 
-                auto deviceInfo = devices[index - 1];
-                if (deviceInfo["type"] != "AC") {
+                const auto& deviceInfo = devices[index - 1];
+                if (deviceInfo.type != "AC") {
                     std::cout << "Only AC devices are supported for now.\n";
                     break;
                 }
@@ -83,7 +84,7 @@ int main() {
                 std::cin >> password;
 
                 if (!acDevice) {
-                    acDevice = std::make_shared<ACProxy>(deviceInfo["id"], deviceInfo["ipAddress"], CLIENTID, deviceInfo["port"]);
+                    acDevice = std::make_shared<ACProxy>(deviceInfo.id, deviceInfo.ipAddress, CLIENTID, deviceInfo.port);
                 }
                 if (acDevice->authenticate(CLIENTID, password)) {
                     std::cout << "Authentication successful!\n";
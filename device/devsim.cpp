@@ -0,0 +1,554 @@
+// devsim: runs a fleet of simulated devices in one process, each with its
+// real CommandHandler and NetworkHandler on its own loopback port, then drives
+// client traffic against them and reports throughput, latency and CPU cost.
+// It is the standard benchmark for changes to the networking and command path.
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include "DeviceRegistry.h"
+#include "DeviceTable.h"
+#include "DiscoveryService.h"
+#include "CommandHandler.h"
+#include "NetworkHandler.h"
+#include "LogSink.h"
+#include "TimerManager.h"
+#include "DeviceSnapshot.h"
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    int devices = 10;
+    int clients = 4;
+    int seconds = 5;
+    int basePort = 20000;
+    std::string type = "mixed";   // light, fan, ac or mixed
+    std::string workload = "mixed"; // poll, auth, burst or mixed
+    bool scan = false;
+    DiscoveryService::Encoding discovery = DiscoveryService::Encoding::JSON;
+    std::string bench;              // table, timers or snapshot: run that micro-benchmark instead
+    int count = 0;                  // Rows, timers or devices for --bench; 0 picks the default
+};
+
+void printUsage() {
+    std::cout << "Usage: ./devsim [--devices <n>] [--clients <n>] [--seconds <n>] [--base-port <port>]\n"
+              << "                [--type light|fan|ac|mixed] [--workload poll|auth|burst|mixed] [--ambient <celsius>] [--discovery json|binary] [--scan]\n"
+              << "  poll   status/details requests on an authenticated connection\n"
+              << "  auth   a fresh connection and authentication per request\n"
+              << "  burst  turn_on/turn_off/set_timer/cancel_timers bursts\n"
+              << "  --scan also measures how long discovery takes to see every device\n"
+              << "  --discovery picks the encoding of the aggregated announcements\n"
+              << "       ./devsim --bench table|timers|snapshot [--count <n>]\n"
+              << "  table    device table kernels over n rows (default 1000000) and update throughput\n"
+              << "  timers   restoring n journaled timers (default 100000)\n"
+              << "  snapshot warm restart of n devices from a snapshot (default 10000)\n";
+}
+
+// One request/response round trip; the device protocol is one JSON object per read
+bool roundTrip(int sock, const json& request, json& response) {
+    std::string payload = request.dump();
+    if (send(sock, payload.data(), payload.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(payload.size())) {
+        return false;
+    }
+    char buffer[4096];
+    ssize_t n = recv(sock, buffer, sizeof(buffer) - 1, 0);
+    if (n <= 0) return false;
+    buffer[n] = '\0';
+    try {
+        response = json::parse(buffer);
+    } catch (const json::exception&) {
+        return false;
+    }
+    return true;
+}
+
+int connectTo(int port) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) return -1;
+    int one = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+// Per-client results, merged once the run is over
+struct ClientStats {
+    std::vector<double> latenciesUs;
+    size_t errors = 0;
+};
+
+// Authenticates on `sock` and returns the token, or "" on failure
+std::string authenticate(int sock, const std::string& clientId, ClientStats& stats) {
+    json response;
+    auto start = Clock::now();
+    bool ok = roundTrip(sock, {{"action", "authenticate"}, {"clientId", clientId}, {"password", "devsim"}}, response);
+    stats.latenciesUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    if (!ok || response.value("status", 0) != 200) {
+        stats.errors++;
+        return "";
+    }
+    return response.value("token", "");
+}
+
+void runClient(int index, const Options& options, std::atomic<bool>& stop, ClientStats& stats) {
+    std::mt19937 random(index * 7919 + 1);
+    std::string clientId = "devsim-" + std::to_string(index);
+    std::vector<std::string> burst = {"turn_on", "set_timer", "turn_off", "cancel_timers"};
+    std::string workload = options.workload;
+
+    while (!stop) {
+        int port = options.basePort + static_cast<int>(random() % options.devices);
+        int sock = connectTo(port);
+        if (sock < 0) {
+            stats.errors++;
+            continue;
+        }
+
+        std::string token = authenticate(sock, clientId, stats);
+        std::string mode = workload == "mixed" ? (random() % 10 == 0 ? "auth" : (random() % 2 ? "poll" : "burst")) : workload;
+        if (!token.empty() && mode != "auth") {
+            // Stay on this device for a while, like a UI polling a selected device
+            for (int i = 0; i < 50 && !stop; ++i) {
+                json request = {{"clientId", clientId}, {"token", token}};
+                if (mode == "poll") {
+                    request["action"] = (i % 2) ? "details" : "status";
+                } else {
+                    request["action"] = burst[i % burst.size()];
+                    request["duration"] = 60;
+                    request["timer_action"] = "turn_on";
+                }
+
+                json response;
+                auto start = Clock::now();
+                bool ok = roundTrip(sock, request, response);
+                stats.latenciesUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+                if (!ok) {
+                    stats.errors++;
+                    break;
+                }
+                // "already on/off" replies are expected when bursts overlap
+                if (response.value("status", 0) != 200 &&
+                    response.value("message", "").find("already") == std::string::npos) {
+                    stats.errors++;
+                }
+            }
+        }
+        close(sock);
+    }
+}
+
+// Joins the discovery group on the beacon port with a 1 s receive timeout;
+// -1 on failure
+int openDiscoverySocket() {
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    int one = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(1900);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    ip_mreq membership{};
+    inet_pton(AF_INET, "239.255.255.250", &membership.imr_multiaddr);
+    membership.imr_interface.s_addr = htonl(INADDR_ANY);
+    if (bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0) {
+        perror("Discovery socket setup failed");
+        close(sock);
+        return -1;
+    }
+    timeval timeout{1, 0};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return sock;
+}
+
+// Listens for discovery beacons until every device has been seen; returns the
+// elapsed seconds, or a negative value on timeout. `datagrams` counts the
+// announcement datagrams received meanwhile.
+double measureScan(const Options& options, size_t& datagrams) {
+    int sock = openDiscoverySocket();
+    if (sock < 0) return -1;
+
+    // Query like DeviceScanner::startScan does, then count the answers
+    sockaddr_in group{};
+    group.sin_family = AF_INET;
+    group.sin_port = htons(1901);
+    inet_pton(AF_INET, "239.255.255.250", &group.sin_addr);
+    std::string query = json{{"action", "discover"}}.dump();
+
+    std::vector<bool> seen(options.devices, false);
+    int remaining = options.devices;
+    auto start = Clock::now();
+    sendto(sock, query.data(), query.size(), 0, reinterpret_cast<sockaddr*>(&group), sizeof(group));
+    char buffer[65536];
+    while (remaining > 0 && Clock::now() - start < std::chrono::seconds(30)) {
+        ssize_t n = recv(sock, buffer, sizeof(buffer), 0);
+        if (n <= 0) continue;
+        DiscoveryService::Message message;
+        if (!DiscoveryService::decode(buffer, static_cast<size_t>(n), message) || message.byebye) continue;
+        datagrams++;
+        for (const auto& announcement : message.announcements) {
+            int index = announcement.port - options.basePort;
+            if (index >= 0 && index < options.devices && !seen[index]) {
+                seen[index] = true;
+                remaining--;
+            }
+        }
+    }
+    close(sock);
+    return remaining == 0 ? std::chrono::duration<double>(Clock::now() - start).count() : -1;
+}
+
+// Median wall time of `runs` calls of `kernel`, in microseconds
+template <typename Kernel>
+double medianUs(int runs, Kernel kernel) {
+    std::vector<double> times;
+    for (int i = 0; i < runs; ++i) {
+        auto start = Clock::now();
+        kernel();
+        times.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+// Fills the device table with `rows` random rows (no Device objects), times
+// the fleet kernels, then measures update throughput from 1 to 8 threads
+int benchTable(int rows) {
+    DeviceTable& table = DeviceTable::getInstance();
+    std::mt19937 random(42);
+    std::vector<DeviceTable::Slot> slots;
+    slots.reserve(rows);
+    for (int i = 0; i < rows; ++i) {
+        DeviceTable::Slot slot = table.allocate();
+        DeviceState state;
+        state.on = random() % 2;
+        state.speed = random() % 4;
+        state.power = state.on ? 10 + random() % 2000 : random() % 4;
+        table.update(slot, state);
+        table.setGroup(slot, static_cast<uint8_t>(random() % 64));
+        slots.push_back(slot);
+    }
+
+    volatile int64_t sink = 0;
+    std::printf("table:      %zu rows\n", table.size());
+    std::printf("countOn:    %.1f us\n", medianUs(21, [&] { sink = sink + static_cast<int64_t>(table.countOn()); }));
+    std::printf("totalPower: %.1f us\n", medianUs(21, [&] { sink = sink + table.totalPower(); }));
+    std::printf("energy:     %.1f us\n", medianUs(21, [&] { sink = sink + table.totalEnergyWattMs(); }));
+    std::printf("byGroup:    %.1f us\n", medianUs(21, [&] { sink = sink + table.powerByGroup()[0]; }));
+
+    for (int threads : {1, 2, 4, 8}) {
+        std::atomic<bool> stop{false};
+        std::atomic<int64_t> updates{0};
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                std::mt19937 local(t + 1);
+                DeviceState state;
+                int64_t done = 0;
+                while (!stop) {
+                    state.on = !state.on;
+                    state.power = state.on ? 100 : 1;
+                    table.update(slots[local() % slots.size()], state);
+                    done++;
+                }
+                updates += done;
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        stop = true;
+        for (auto& worker : workers) worker.join();
+        std::printf("updates:    %d threads, %.2f M/s\n", threads, updates / 0.5 / 1e6);
+    }
+    std::fflush(stdout);
+    return 0;
+}
+
+// Journals `count` timers through one TimerManager, then times how long a
+// fresh manager takes to restore them from the journal
+int benchTimers(int count) {
+    mkdir("data", 0755);
+    const std::string path = "data/devsim_bench_timers.journal";
+    std::remove(path.c_str());
+    {
+        TimerManager writer;
+        writer.enablePersistence(path, TimerCatchUp::FIRE);
+        for (int i = 0; i < count; ++i) {
+            writer.setTimer(3600 + i % 86400, i % 2 ? "turn_on" : "turn_off");
+        }
+        writer.detach();
+    }
+
+    TimerManager reader;
+    auto start = Clock::now();
+    size_t restored = reader.enablePersistence(path, TimerCatchUp::FIRE);
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    reader.detach();
+    std::remove(path.c_str());
+    std::printf("timers:     restored %zu of %d journaled timers in %.1f ms\n", restored, count, ms);
+    std::fflush(stdout);
+    return restored == static_cast<size_t>(count) ? 0 : 1;
+}
+
+// Counts announcement datagrams until `stop` is set
+void countBeacons(const std::atomic<bool>& stop, size_t& datagrams) {
+    int sock = openDiscoverySocket();
+    if (sock < 0) return;
+    char buffer[65536];
+    while (!stop) {
+        ssize_t n = recv(sock, buffer, sizeof(buffer), 0);
+        DiscoveryService::Message message;
+        if (n > 0 && DiscoveryService::decode(buffer, static_cast<size_t>(n), message) && !message.byebye) {
+            datagrams++;
+        }
+    }
+    close(sock);
+}
+
+// Snapshots `count` devices in varied states, then times a warm restart the
+// way main does it for one device: load the snapshot, create each device,
+// restore its state, build its CommandHandler and track it again. Binding
+// the TCP ports is left out; devsim's select()-based servers cap a process
+// at 900 devices.
+int benchSnapshot(int count) {
+    mkdir("data", 0755);
+    mkdir("log", 0755);
+    LogSink::configureShared("log/devsim", 1);
+    const std::string path = "data/devsim_bench_snapshot.bin";
+    std::remove(path.c_str());
+    const char* types[] = {"Light", "Fan", "AC"};
+    DeviceRegistry& registry = DeviceRegistry::getInstance();
+
+    double writeMs;
+    {
+        DeviceSnapshot snapshot(path);
+        std::vector<std::unique_ptr<CommandHandler>> handlers;
+        for (int i = 0; i < count; ++i) {
+            auto device = registry.create(types[i % 3], "sim" + std::to_string(i), "devsim");
+            DeviceState state = device->getState();
+            state.on = i % 2;
+            state.temperature = 18 + i % 10;
+            device->restoreState(state);
+            handlers.push_back(std::make_unique<CommandHandler>(device, "pw" + std::to_string(i)));
+            snapshot.track(device, *handlers.back(), "pw" + std::to_string(i));
+        }
+        auto start = Clock::now();
+        snapshot.writeNow();
+        writeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+    struct stat info{};
+    stat(path.c_str(), &info);
+
+    auto start = Clock::now();
+    DeviceSnapshot snapshot(path);
+    auto saved = snapshot.load();
+    double loadMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::vector<std::unique_ptr<CommandHandler>> handlers;
+    int matching = 0;
+    for (const auto& entry : saved) {
+        const DeviceSnapshot::Record& record = entry.second;
+        auto device = registry.create(record.type, record.id, record.password);
+        device->restoreState(DeviceState::unpack(record.state));
+        handlers.push_back(std::make_unique<CommandHandler>(device, record.password));
+        snapshot.track(device, *handlers.back(), record.password);
+        int i = std::stoi(record.id.substr(3));
+        DeviceState state = device->getState();
+        if (state.on == (i % 2 == 1) && state.temperature == 18 + i % 10) matching++;
+    }
+    double restartMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::remove(path.c_str());
+
+    std::printf("snapshot:   %d devices, %lld bytes, written in %.1f ms\n", count,
+                static_cast<long long>(info.st_size), writeMs);
+    std::printf("restart:    %d of %d devices restored in %.1f ms (snapshot load %.1f ms)\n", matching, count,
+                restartMs, loadMs);
+    std::fflush(stdout);
+    // Skip tearing down thousands of devices; the numbers are out
+    std::_Exit(matching == count ? 0 : 1);
+}
+
+double cpuSeconds() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--devices" && i + 1 < argc) {
+            options.devices = std::stoi(argv[++i]);
+        } else if (arg == "--clients" && i + 1 < argc) {
+            options.clients = std::stoi(argv[++i]);
+        } else if (arg == "--seconds" && i + 1 < argc) {
+            options.seconds = std::stoi(argv[++i]);
+        } else if (arg == "--base-port" && i + 1 < argc) {
+            options.basePort = std::stoi(argv[++i]);
+        } else if (arg == "--type" && i + 1 < argc) {
+            options.type = argv[++i];
+        } else if (arg == "--workload" && i + 1 < argc) {
+            options.workload = argv[++i];
+        } else if (arg == "--discovery" && i + 1 < argc) {
+            std::string encoding = argv[++i];
+            if (encoding != "json" && encoding != "binary") {
+                printUsage();
+                return 1;
+            }
+            options.discovery = encoding == "binary" ? DiscoveryService::Encoding::BINARY
+                                                     : DiscoveryService::Encoding::JSON;
+            DiscoveryService::getInstance().setEncoding(options.discovery);
+        } else if (arg == "--ambient" && i + 1 < argc) {
+            PowerModel::setAmbient(std::stod(argv[++i]));
+        } else if (arg == "--scan") {
+            options.scan = true;
+        } else if (arg == "--bench" && i + 1 < argc) {
+            options.bench = argv[++i];
+            if (options.bench != "table" && options.bench != "timers" && options.bench != "snapshot") {
+                printUsage();
+                return 1;
+            }
+        } else if (arg == "--count" && i + 1 < argc) {
+            options.count = std::stoi(argv[++i]);
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (!options.bench.empty()) {
+        // Mute the debug output of the code under test
+        std::cout.setstate(std::ios::failbit);
+        if (options.bench == "table") return benchTable(options.count > 0 ? options.count : 1000000);
+        if (options.bench == "snapshot") return benchSnapshot(options.count > 0 ? options.count : 10000);
+        return benchTimers(options.count > 0 ? options.count : 100000);
+    }
+
+    // Each device serves with select(), so every descriptor in the process
+    // must stay below FD_SETSIZE
+    if (options.devices < 1 || options.clients < 1 || options.devices + 2 * options.clients > 900) {
+        std::cerr << "Error: need 1 or more devices and clients, with devices + 2 * clients <= 900.\n";
+        return 1;
+    }
+
+    mkdir("log", 0755);
+    LogSink::configureShared("log/devsim", 1);
+
+    std::printf("devsim: %d devices (%s), %d clients, workload %s, %ds\n", options.devices, options.type.c_str(),
+                options.clients, options.workload.c_str(), options.seconds);
+    std::fflush(stdout);
+    // Mute the devices' debug output so console writes do not skew the timings
+    std::cout.setstate(std::ios::failbit);
+
+    // Bring up the fleet
+    std::vector<std::string> types = {"Light", "Fan", "AC"};
+    std::vector<std::shared_ptr<Device>> devices;
+    std::vector<std::unique_ptr<CommandHandler>> handlers;
+    std::vector<std::unique_ptr<NetworkHandler>> servers;
+    for (int i = 0; i < options.devices; ++i) {
+        std::string type = options.type == "mixed" ? types[i % types.size()] : options.type;
+        auto device = DeviceRegistry::getInstance().create(type, "sim" + std::to_string(i), "devsim");
+        handlers.push_back(std::make_unique<CommandHandler>(device, "devsim"));
+        servers.push_back(std::make_unique<NetworkHandler>(*handlers.back(), options.basePort + i));
+        servers.back()->start();
+        devices.push_back(device);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200)); // Let the servers bind
+
+    if (options.scan) {
+        size_t datagrams = 0;
+        double scanSeconds = measureScan(options, datagrams);
+        if (scanSeconds < 0) {
+            std::printf("scan:       not every device was discovered within 30s\n");
+        } else {
+            std::printf("scan:       all devices discovered in %.2f s from %zu datagrams\n", scanSeconds, datagrams);
+        }
+    }
+
+    // Drive the load
+    std::atomic<bool> stop{false};
+    std::vector<ClientStats> stats(options.clients);
+    std::vector<std::thread> clients;
+    size_t beaconDatagrams = 0;
+    std::thread beaconCounter(countBeacons, std::cref(stop), std::ref(beaconDatagrams));
+    double cpuBefore = cpuSeconds();
+    auto start = Clock::now();
+    for (int i = 0; i < options.clients; ++i) {
+        clients.emplace_back(runClient, i, std::cref(options), std::ref(stop), std::ref(stats[i]));
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(options.seconds));
+    stop = true;
+    for (auto& client : clients) client.join();
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    double cpu = cpuSeconds() - cpuBefore;
+    beaconCounter.join();
+
+    // Report
+    std::vector<double> latencies;
+    size_t errors = 0;
+    for (auto& clientStats : stats) {
+        latencies.insert(latencies.end(), clientStats.latenciesUs.begin(), clientStats.latenciesUs.end());
+        errors += clientStats.errors;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) {
+        if (latencies.empty()) return 0.0;
+        size_t index = std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()));
+        return latencies[index];
+    };
+
+    size_t requests = latencies.size();
+    std::printf("requests:   %zu (%zu errors)\n", requests, errors);
+    std::printf("throughput: %.0f req/s\n", requests / elapsed);
+    std::printf("latency:    p50 %.1f us, p99 %.1f us, p999 %.1f us\n",
+                percentile(0.50), percentile(0.99), percentile(0.999));
+    std::printf("cpu:        %.1f us per request (devices and clients)\n", requests ? cpu * 1e6 / requests : 0.0);
+
+    // Fleet totals come straight from the device table
+    DeviceTable& table = DeviceTable::getInstance();
+    auto queryStart = Clock::now();
+    int64_t fleetPower = table.totalPower();
+    int64_t fleetEnergy = table.totalEnergyWattMs();
+    double queryUs = std::chrono::duration<double, std::micro>(Clock::now() - queryStart).count();
+    std::printf("fleet:      %zu of %zu on, %lld W now, %.1f Wh so far (table query %.1f us)\n",
+                table.countOn(), table.size(), static_cast<long long>(fleetPower), fleetEnergy / 3.6e6, queryUs);
+
+    // State changes may bring beacons forward, but at most one announcement
+    // of the whole fleet per minimum interval on top of the regular ones.
+    // Allow two more for the tail of the startup burst and the scan answer.
+    std::vector<DiscoveryService::Announcement> fleet;
+    for (int i = 0; i < options.devices; ++i) {
+        fleet.push_back({devices[i]->getId(), devices[i]->getType(), options.basePort + i});
+    }
+    size_t perAnnouncement = DiscoveryService::encode(fleet, options.discovery, "127.0.0.1", 6).size();
+    size_t intervals = static_cast<size_t>(elapsed * 1000 / DiscoveryService::getInstance().getMinIntervalMs()) + 1;
+    size_t beaconLimit = perAnnouncement * (2 * intervals + 2);
+    bool beaconsOk = beaconDatagrams <= beaconLimit;
+    std::printf("beacons:    %zu datagrams in %.0f s (limit %zu)%s\n", beaconDatagrams, elapsed, beaconLimit,
+                beaconsOk ? "" : " EXCEEDED");
+    std::fflush(stdout);
+
+    // The servers run on detached threads without a shutdown path; skip
+    // destructors rather than tear the fleet down underneath them
+    std::_Exit(beaconsOk ? 0 : 1);
+}
@@ -2,9 +2,7 @@
 #define COMMAND_HANDLER_H
 
 #include "Device.h"
-#include "Light.h"
-#include "Fan.h"
-#include "AC.h"
+#include "DeviceRegistry.h"
 #include "AuthenticationManager.h"
 #include "../lib/json.hpp"
 
@@ -12,9 +10,15 @@ class CommandHandler {
 private:
     std::shared_ptr<Device> device;
     AuthenticationManager authManager;
+    const DeviceTypeInfo* typeInfo; // Resolved once; nullptr for unregistered types
+    std::function<void(const std::string&)> passwordListener;
 public:
     CommandHandler(std::shared_ptr<Device> device, const std::string& password);
     nlohmann::json handleCommand(const nlohmann::json& command);
+    // Called with the new password after each successful change_password
+    void setPasswordListener(std::function<void(const std::string&)> listener) {
+        passwordListener = std::move(listener);
+    }
     std::shared_ptr<Device> getDevice() const {
         return device;
     }
@@ -2,9 +2,17 @@
 #define DEVICE_H
 
 #include <string>
+#include <vector>
+#include <utility>
 #include <queue>
 #include <mutex>
+#include <atomic>
 #include <condition_variable>
+#include <algorithm>
+#include <functional>
+#include "DeviceState.h"
+#include "DeviceTable.h"
+#include "PowerModel.h"
 #include "TimerManager.h"
 #include "RuntimeTracker.h"
 #include "AuthenticationManager.h"
@@ -14,28 +22,97 @@
 class Device {
 protected:
     std::string id;
-    int powerConsumption = 0;
-    bool state = false;
+
+    // Packed DeviceState; replaced only by compare-and-swap in transition()
+    std::atomic<uint64_t> stateWord{DeviceState{}.pack()};
+
+    // The runtime tracker follows the latest state word; trackerMutex
+    // serializes the catch-up so start/stop calls are never reordered.
+    std::mutex trackerMutex;
+    bool trackedOn = false;
+    int trackedPower = 0;
+
+    // This device's row in the process-wide DeviceTable, updated with the tracker
+    DeviceTable::Slot tableSlot;
+
+    // Called after every transition, under trackerMutex, in the order added
+    std::vector<std::pair<uint64_t, std::function<void()>>> changeListeners;
+    uint64_t nextListenerId = 1;
+
+    // Computes the draw for each new state; see setPowerModel
+    std::shared_ptr<const PowerModel> powerModel;
 
     // Components
     TimerManager timerManager;
     RuntimeTracker runtimeTracker;
     Logger logger;
 
+    // Atomically replaces the state with `change(current)`, retrying if
+    // another thread got there first. `change` may throw to reject the
+    // transition and must not have side effects. The power draw of the new
+    // state is filled in from powerFor. Returns the new state.
+    template <typename Change>
+    DeviceState transition(Change change) {
+        uint64_t current = stateWord.load(std::memory_order_acquire);
+        DeviceState next;
+        do {
+            next = change(DeviceState::unpack(current));
+            next.power = std::clamp(powerFor(next), 0, 0xFFFF);
+        } while (!stateWord.compare_exchange_weak(current, next.pack(),
+                                                  std::memory_order_acq_rel, std::memory_order_acquire));
+        syncTracker();
+        return next;
+    }
+
+    void syncTracker();
+
+    // Power draw in watts in `state`, on or off; defaults to the power model
+    virtual int powerFor(const DeviceState& state) const;
+    // Adjusts the state being turned on (e.g. a default speed)
+    virtual void prepareTurnOn(DeviceState& state) const {}
+    // Adds type-specific fields of `state` to the detailed info
+    virtual void addDetails(const DeviceState& state, nlohmann::json& details) const {}
+
 public:
     explicit Device(const std::string& id, const std::string& password);
-    ~Device();
+    virtual ~Device();
+
+    void turnOn();
+    void turnOff();
 
-    virtual void turnOn();
-    virtual void turnOff();
+    // Replaces the power model and re-evaluates the current draw. Meant for
+    // setup, before commands or timers can reach the device.
+    void setPowerModel(std::shared_ptr<const PowerModel> model);
+
+    // Puts the device back into a saved state (see DeviceSnapshot)
+    void restoreState(const DeviceState& state);
+    // Listeners must be cheap. Returns an ID for removeChangeListener.
+    uint64_t addChangeListener(std::function<void()> listener);
+    void removeChangeListener(uint64_t listenerId);
     virtual std::string getType() const = 0;
+
+    // Never blocks
+    DeviceState getState() const { return DeviceState::unpack(stateWord.load(std::memory_order_acquire)); }
     
-    void setTimer(int duration, const std::string& action);
+    uint64_t setTimer(int duration, const std::string& action);
+    uint64_t setSchedule(const TimerSchedule& schedule, const std::string& action);
+    bool cancelTimer(uint64_t timerId);
     void cancelAllTimers();
+    // Cancels all timers and waits for a running timer action. Must run
+    // before the derived object is destroyed, since actions call the
+    // virtual turnOn/turnOff; DeviceRegistry::create arranges this.
+    void detachTimers();
+    nlohmann::json listTimers();
+    // Persist timers to `journalPath` and restore the ones saved there
+    size_t enableTimerPersistence(const std::string& journalPath, TimerCatchUp catchUp);
+    // Resume runtime counters from `statePath` and checkpoint them there
+    void enableRuntimePersistence(const std::string& statePath);
 
     std::string getId() const { return id; }
     nlohmann::json getInfo() const;
-    virtual nlohmann::json getDetailedInfo() const;
+    nlohmann::json getDetailedInfo() const;
+    // Runtime and energy between two epoch times, in periods of up to `resolution` seconds
+    nlohmann::json getHistory(int64_t fromSeconds, int64_t toSeconds, int64_t resolution);
     Logger& getLogger() { return logger; }
 };
 
@@ -0,0 +1,58 @@
+#ifndef DEVICE_REGISTRY_H
+#define DEVICE_REGISTRY_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include "Device.h"
+#include "../lib/json.hpp"
+
+// Handles one type-specific command; the device is always of the type the
+// handler was registered for. Returns the JSON reply.
+using DeviceAction = std::function<nlohmann::json(Device& device, const nlohmann::json& command)>;
+
+// Everything the host needs to know about a device type
+struct DeviceTypeInfo {
+    std::string name;                     // As reported by Device::getType(), e.g. "Fan"
+    std::vector<std::string> stateFields; // Type-specific fields in `details`
+    std::string powerModel;               // Human-readable power draw
+    std::unordered_map<std::string, DeviceAction> actions;
+    std::function<std::shared_ptr<Device>(const std::string& id, const std::string& password)> create;
+};
+
+// Known device types: the built-in ones plus any loaded from plugins.
+// A plugin is a shared object exporting
+//     extern "C" void registerDeviceTypes(DeviceRegistry& registry);
+// and is built against these headers.
+class DeviceRegistry {
+public:
+    static DeviceRegistry& getInstance();
+
+    // Throws std::invalid_argument if the name is taken
+    void registerType(DeviceTypeInfo info);
+
+    // Case-insensitive; nullptr if unknown
+    const DeviceTypeInfo* find(const std::string& name) const;
+    // Throws std::invalid_argument for unknown types
+    std::shared_ptr<Device> create(const std::string& name, const std::string& id, const std::string& password) const;
+    std::vector<const DeviceTypeInfo*> types() const;
+
+    // Throws std::runtime_error if the plugin cannot be loaded
+    void loadPlugin(const std::string& path);
+    // Loads every *.so in `directory`; throws std::runtime_error if it cannot
+    // be opened. Plugins that fail to load are skipped with a warning.
+    size_t loadPluginDirectory(const std::string& directory);
+
+private:
+    DeviceRegistry() = default;
+
+    std::unordered_map<std::string, std::unique_ptr<DeviceTypeInfo>> typesByName; // Keyed by lowercase name
+    std::vector<void*> pluginHandles; // Kept open for the life of the process
+};
+
+// Registers Light, Fan and AC
+void registerBuiltinDeviceTypes(DeviceRegistry& registry);
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef DEVICE_SNAPSHOT_H
+#define DEVICE_SNAPSHOT_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include "Device.h"
+#include "CommandHandler.h"
+
+// Warm-restart snapshot of every tracked device: type, ID, password and the
+// packed state word (on, speed, mode, temperature). Timers and runtime
+// counters have their own journal and state file. The snapshot is one compact
+// binary file, rewritten via a temporary file and rename so a crash leaves
+// either the old or the new snapshot. A background thread writes it shortly
+// after any change and periodically otherwise.
+class DeviceSnapshot {
+public:
+    struct Record {
+        std::string type;
+        std::string id;
+        std::string password;
+        uint64_t state = 0; // DeviceState::pack()
+    };
+
+    explicit DeviceSnapshot(const std::string& path, std::chrono::seconds interval = std::chrono::seconds(30));
+    // Stops the writer after a final write. Must be destroyed after the
+    // handlers it tracks, i.e. declared before them.
+    ~DeviceSnapshot();
+
+    // Records of the last snapshot keyed by device ID; empty if there is no
+    // readable snapshot
+    std::unordered_map<std::string, Record> load() const;
+
+    // Includes `device` in future snapshots and follows its state and the
+    // handler's password changes
+    void track(const std::shared_ptr<Device>& device, CommandHandler& handler, const std::string& password);
+    void start();
+    void markDirty();
+    // Throws std::runtime_error if the file cannot be written
+    void writeNow();
+
+private:
+    struct Entry {
+        std::shared_ptr<Device> device;
+        std::string password;
+        uint64_t listenerId = 0;
+    };
+
+    std::string path;
+    std::chrono::seconds interval;
+
+    std::mutex mutex; // Guards entries and the writer's flags
+    std::vector<Entry> entries;
+    std::condition_variable writerCondition;
+    std::thread writerThread;
+    bool dirty = false;
+    bool stopWriter = false;
+
+    static std::string encode(const std::vector<Record>& records);
+    static bool decode(const std::string& bytes, std::vector<Record>& records);
+    void writerThreadFunction();
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef DEVICE_STATE_H
+#define DEVICE_STATE_H
+
+#include <cstdint>
+
+// All mutable device state, packed into one 64-bit word so it can be read
+// and replaced atomically:
+//   bit 0       on
+//   bits 1-3    fan speed (0-7)
+//   bits 4-5    AC mode
+//   bits 8-15   AC temperature
+//   bits 16-31  power draw in watts
+struct DeviceState {
+    bool on = false;
+    int speed = 0;
+    int mode = 0;
+    int temperature = 24;
+    int power = 0;
+
+    uint64_t pack() const {
+        return (on ? 1ULL : 0ULL)
+             | (static_cast<uint64_t>(speed & 0x7) << 1)
+             | (static_cast<uint64_t>(mode & 0x3) << 4)
+             | (static_cast<uint64_t>(temperature & 0xFF) << 8)
+             | (static_cast<uint64_t>(power & 0xFFFF) << 16);
+    }
+
+    static DeviceState unpack(uint64_t word) {
+        DeviceState state;
+        state.on = word & 1;
+        state.speed = static_cast<int>((word >> 1) & 0x7);
+        state.mode = static_cast<int>((word >> 4) & 0x3);
+        state.temperature = static_cast<int>((word >> 8) & 0xFF);
+        state.power = static_cast<int>((word >> 16) & 0xFFFF);
+        return state;
+    }
+};
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef DEVICE_TABLE_H
+#define DEVICE_TABLE_H
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include "DeviceState.h"
+
+// Structure-of-arrays copy of the state of every device in the process, kept
+// in sync by Device on each transition. Fleet-wide queries scan one or two
+// dense columns instead of walking polymorphic Device objects. Slots are
+// grouped in blocks of kBlock, so the kernels' inner loops have a fixed trip
+// count, which lets the compiler vectorize them at -O2.
+//
+// Each block has its own mutex. A transition locks only its device's block,
+// so transitions of devices in different blocks do not contend; a kernel
+// locks one block at a time while it scans it. Columns live in chunks of
+// kChunkBlocks blocks that are never moved or freed, so a kernel can walk
+// them while others are added.
+class DeviceTable {
+public:
+    using Slot = uint32_t;
+    static constexpr size_t kBlock = 64;
+    static constexpr size_t kChunkBlocks = 1024;
+    static constexpr size_t kMaxChunks = 64; // 4M slots
+    static constexpr size_t kMaxGroups = 256;
+
+    static DeviceTable& getInstance();
+
+    // Throws std::runtime_error once every chunk is in use
+    Slot allocate();
+    void release(Slot slot);
+    // Records `state` as of now, closing the energy drawn in the previous state
+    void update(Slot slot, const DeviceState& state);
+    // Groups (e.g. rooms) for powerByGroup; every slot starts in group 0
+    void setGroup(Slot slot, uint8_t group);
+
+    size_t size() const;
+    size_t countOn() const;
+    int64_t totalPower() const;         // Watts drawn right now
+    int64_t totalEnergyWattMs() const;  // Energy drawn by the current devices, running sessions included
+    std::vector<int64_t> powerByGroup() const; // kMaxGroups entries
+
+private:
+    static constexpr size_t kChunk = kBlock * kChunkBlocks; // Slots per chunk
+
+    // Free slots hold zeros, so the kernels need no liveness check. Columns
+    // are indexed by slot within the chunk, the rest by block.
+    struct Chunk {
+        std::mutex mutex[kChunkBlocks];
+        uint8_t on[kChunk] = {};
+        uint8_t speed[kChunk] = {};
+        uint8_t mode[kChunk] = {};
+        uint8_t temperature[kChunk] = {};
+        uint8_t group[kChunk] = {};
+        uint16_t power[kChunk] = {};         // Draw in watts, standby included
+        int64_t sessionStartMs[kChunk] = {}; // When `power` took effect, relative to originMs
+        int64_t energyWattMs[kChunk] = {};   // Energy drawn before sessionStartMs
+
+        // Per block, the sum of energyWattMs - power * sessionStartMs, so the
+        // block's energy at time t is energyOffset + t * (sum of power)
+        int64_t energyOffset[kChunkBlocks] = {};
+    };
+
+    DeviceTable();
+
+    int64_t nowMs() const;
+    Chunk& chunkOf(Slot slot) const { return *chunks[slot / kChunk]; }
+    size_t blockCount() const { return (used.load(std::memory_order_acquire) + kBlock - 1) / kBlock; }
+
+    int64_t originMs;                     // steady_clock; keeps the products above small
+    std::unique_ptr<Chunk> chunks[kMaxChunks]; // Filled in order, before `used` covers them
+    std::atomic<size_t> used{0};          // Slots handed out so far, live or free
+    std::atomic<size_t> live{0};
+
+    std::mutex allocMutex; // Serializes allocation and guards freeSlots
+    std::vector<Slot> freeSlots;
+};
+
+#endif
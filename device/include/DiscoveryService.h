@@ -0,0 +1,107 @@
+#ifndef DISCOVERY_SERVICE_H
+#define DISCOVERY_SERVICE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <cstddef>
+
+// Process-wide discovery announcer. Every NetworkHandler in the process
+// registers its device here, and one thread announces all of them on the
+// multicast group, packing as many device records as fit into each datagram.
+// It also answers scanners' search queries (see queryPort below).
+//
+// Announcements come in a quick burst at startup and whenever a device is
+// added, then back off exponentially while nothing changes. A state change
+// only brings the next announcement forward, at most once per minimum
+// interval, without resetting the backoff. Each carries a
+// ttl in seconds after which scanners may forget the device if no newer
+// announcement arrived. Withdrawn devices, and all devices when the process
+// shuts down, are announced once more as departing ("byebye").
+//
+// A host with a single device sends the classic one-device JSON object plus
+// "ttl" (and "action": "byebye" when departing). Otherwise datagrams are
+// either JSON
+//     {"ipAddress": "...", "ttl": n, "devices": [{"id": ..., "type": ..., "port": ...}, ...]}
+// or, with Encoding::BINARY, "DSC2", a flags byte (bit 0: byebye), the ttl
+// as 16 bits, the IPv4 address, a table of type names and the records sorted
+// by ID, each stored as a type index, the length of the prefix shared with
+// the previous ID, the rest of the ID and the port as a zigzag varint delta.
+// Integers are little endian.
+//
+// This is the one specification of the formats. The client's
+// DeviceScanner::parseAnnouncement accepts exactly what decode() accepts;
+// tests/DiscoveryFormatTest round-trips encode() through both.
+class DiscoveryService {
+public:
+    enum class Encoding { JSON, BINARY };
+
+    struct Announcement {
+        std::string id;
+        std::string type;
+        int port = 0;
+    };
+
+    // One decoded datagram
+    struct Message {
+        std::string ipAddress;
+        int ttl = 0;          // Seconds; 0 if the sender gave none
+        bool byebye = false;  // The devices are leaving
+        std::vector<Announcement> announcements;
+    };
+
+    static constexpr size_t MAX_DATAGRAM = 1400; // Stays within a typical Ethernet MTU
+
+    static DiscoveryService& getInstance();
+
+    void setEncoding(Encoding encoding);
+    void announce(const Announcement& announcement);
+    void withdraw(const std::string& id);
+    // A device changed state; announces early unless the last announcement
+    // is less than the minimum interval old. Cheap enough to call from every
+    // transition.
+    void stateChanged();
+    int getMinIntervalMs() const { return minIntervalMs; }
+
+    // Packs `announcements` into datagrams of at most MAX_DATAGRAM bytes.
+    // Falls back to JSON for records the binary form cannot hold (an ID longer
+    // than 255 bytes, more than 255 types).
+    static std::vector<std::string> encode(const std::vector<Announcement>& announcements, Encoding encoding,
+                                           const std::string& ipAddress, int ttl, bool byebye = false);
+    // Accepts any of the forms above; false if the datagram is not an announcement
+    static bool decode(const char* data, size_t size, Message& message);
+
+private:
+    DiscoveryService();
+    ~DiscoveryService();
+
+    void run();
+    void wake();
+
+    std::string multicastIP = "239.255.255.250";
+    int multicastPort = 1900;
+    int queryPort = 1901;         // Scanners' discovery queries, on the same group
+    std::string ipAddress = "127.0.0.1";
+    int burstCount = 3;           // Announcements in a burst
+    int burstSpacingMs = 250;
+    int minIntervalMs = 2000;     // First interval after a burst, doubled per announcement
+    int maxIntervalMs = 60000;
+    int ttlFactor = 3;            // ttl covers this many intervals, so one lost datagram is harmless
+    int maxResponseDelayMs = 100; // Replies to a query are spread over this window
+    int settleDelayMs = 50;       // Devices added together are announced together
+
+    std::mutex mutex; // Guards everything below
+    std::map<std::string, Announcement> devices; // Sorted by ID for prefix compression
+    std::vector<Announcement> departed;          // Withdrawn, byebye not yet sent
+    Encoding encoding = Encoding::JSON;
+    bool changed = false;
+    bool added = false;   // Start a new burst
+    bool refresh = false; // Announce early; cleared by the next announcement
+    bool stopFlag = false;
+    std::thread thread;
+    int wakeFd = -1;
+};
+
+#endif
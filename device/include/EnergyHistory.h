@@ -0,0 +1,82 @@
+#ifndef ENERGY_HISTORY_H
+#define ENERGY_HISTORY_H
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Runtime and energy history in three tiers. Raw minutes live in a small
+// ring buffer; every minute is also rolled up into hour and day totals, which
+// are stored delta/varint compressed so months of history fit in a few KB.
+// Only periods in which the device was on are stored. Days are UTC days.
+class EnergyHistory {
+public:
+    // Raw minute sample, 12 bytes
+    struct Sample {
+        uint32_t minute;      // Minutes since the Unix epoch
+        uint32_t runtimeMs;   // Time on within this minute
+        uint32_t wattSeconds; // Energy used within this minute
+    };
+
+    // One query result at the resolution of the tier it came from
+    struct Point {
+        int64_t start;        // Epoch seconds
+        uint32_t period;      // 60, 3600 or 86400
+        uint64_t runtimeMs;
+        uint64_t wattSeconds;
+    };
+
+    explicit EnergyHistory(size_t minuteCapacity = 120, int hourRetentionDays = 31, int dayRetentionDays = 400);
+
+    // Accounts the interval [fromMs, toMs) (epoch milliseconds) at `power`
+    // watts, split across the minutes it covers.
+    void add(int64_t fromMs, int64_t toMs, int power);
+
+    // Points overlapping [fromSeconds, toSeconds], oldest first. Uses the
+    // coarsest tier whose period is at most `resolution` seconds; the part of
+    // the range that tier no longer holds comes from the coarser tiers.
+    std::vector<Point> query(int64_t fromSeconds, int64_t toSeconds, int64_t resolution = 60) const;
+
+private:
+    // Append-only series of (start, runtime, energy) records for one tier,
+    // packed into blocks of varints: start delta in periods, runtime
+    // seconds, watt-seconds. Whole blocks expire once past the retention.
+    struct Tier {
+        struct Block {
+            int64_t firstStart = 0;
+            int64_t lastStart = 0;
+            uint16_t count = 0;
+            std::string bytes;
+        };
+
+        uint32_t period;
+        int64_t retention;     // Seconds
+        std::deque<Block> blocks;
+        int64_t coverageStart = 0; // Earliest time still fully held
+        Point open{};          // Period being accumulated, not yet appended
+
+        Tier(uint32_t period, int64_t retention) : period(period), retention(retention) {}
+
+        void accumulate(int64_t seconds, uint32_t runtimeMs, uint32_t wattSeconds);
+        void append(const Point& point);
+        void collect(int64_t fromSeconds, int64_t toSeconds, std::vector<Point>& out) const;
+    };
+
+    static constexpr size_t BLOCK_RECORDS = 64;
+
+    std::vector<Sample> samples;
+    size_t head = 0;  // Index of the oldest sample
+    size_t count = 0;
+    int64_t minuteCoverageStart = 0;
+    int64_t wattMsRemainder = 0; // Energy below one watt-second, carried forward
+    Tier hours;
+    Tier days;
+
+    const Sample& at(size_t index) const { return samples[(head + index) % samples.size()]; }
+    Sample& sampleFor(uint32_t minute);
+    void collectMinutes(int64_t fromSeconds, int64_t toSeconds, std::vector<Point>& out) const;
+};
+
+#endif
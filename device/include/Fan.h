@@ -4,25 +4,21 @@
 #include "Device.h"
 
 class Fan : public Device {
-private:
-    int speed = 0; // Speed level (0: off, 1-3: speed levels)
+protected:
+    void prepareTurnOn(DeviceState& state) const override;
+    void addDetails(const DeviceState& state, nlohmann::json& details) const override {
+        details["speed"] = state.speed;
+    }
+
 public:
     Fan(const std::string& id, const std::string& password);
 
-    void turnOn() override;
-    void turnOff() override;
-    void setSpeed(int speed);
+    void setSpeed(int speed); // Speed level (0: off, 1-3: speed levels)
     int getSpeed() const;
 
     std::string getType() const override {
         return "Fan";
     }
-
-    nlohmann::json getDetailedInfo() const override {
-        nlohmann::json details = Device::getDetailedInfo();
-        details["speed"] = speed;
-        return details;
-    }
 };
 
 #endif
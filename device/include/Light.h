@@ -7,12 +7,9 @@ class Light : public Device {
 public:
     Light(const std::string& id, const std::string& password);
 
-    void turnOn() override;
-    void turnOff() override;
-
     std::string getType() const override {
         return "Light";
     }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,56 @@
+#ifndef LOG_SINK_H
+#define LOG_SINK_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+
+// Shared, buffered log backend. Many Logger front-ends (one per device) feed
+// into a small, fixed number of shard files; each line carries its device tag
+// so per-device files can be recovered offline with demultiplex().
+class LogSink {
+private:
+    struct Shard {
+        std::ofstream stream;
+        std::string buffer;
+        std::mutex mutex;
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    size_t bufferLimit;
+
+    std::thread flushThread;
+    std::mutex flushMutex;
+    std::condition_variable flushCondition;
+    bool stopFlush = false;
+
+    static std::string sharedBasePath;
+    static size_t sharedShardCount;
+
+    void flushShard(Shard &shard);
+    void flushThreadFunction();
+
+public:
+    LogSink(const std::string &basePath, size_t shardCount = 1, size_t bufferLimit = 64 * 1024);
+    ~LogSink();
+
+    // Process-wide sink used by default by every Logger.
+    static std::shared_ptr<LogSink> getShared();
+    // Must be called before the first getShared() to take effect.
+    static void configureShared(const std::string &basePath, size_t shardCount);
+
+    void write(const std::string &deviceId, const std::string &line, bool urgent = false);
+    void flush();
+
+    // Split a shard file into <outputDir>/device_<id>.log files. Lines whose
+    // ID is not a plain file name part (letters, digits, '-', '_', '.', no
+    // leading '.') are skipped with a warning. Returns the number of lines written.
+    static size_t demultiplex(const std::string &logFile, const std::string &outputDir);
+};
+
+#endif
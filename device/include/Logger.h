@@ -2,9 +2,12 @@
 #define LOGGER_H
 
 #include <string>
-#include <fstream>
-#include <mutex>
+#include <memory>
+#include <atomic>
+#include "LogSink.h"
 
+// Lightweight per-device front-end: formats and filters lines, then hands
+// them to a (usually shared) LogSink.
 class Logger {
 public:
     enum LogLevel {
@@ -14,7 +17,7 @@ public:
         DEBUG
     };
 
-    explicit Logger(const std::string &logFile);
+    explicit Logger(std::shared_ptr<LogSink> sink = LogSink::getShared());
     ~Logger();
 
     void logEvent(const std::string &deviceId, const std::string &message, LogLevel level = INFO);
@@ -23,9 +26,13 @@ public:
     void logWarn(const std::string &deviceId, const std::string &message);
     void logDebug(const std::string &deviceId, const std::string &message);
 
+    // Per-logger filtering (all levels enabled by default)
+    void setLevelEnabled(LogLevel level, bool enabled);
+    bool isLevelEnabled(LogLevel level) const;
+
 private:
-    std::ofstream logStream;
-    std::mutex logMutex;
+    std::shared_ptr<LogSink> sink;
+    std::atomic<unsigned> enabledLevels{(1u << INFO) | (1u << WARN) | (1u << ERROR) | (1u << DEBUG)};
 
     std::string formatLog(const std::string &deviceId, const std::string &message, LogLevel level);
     std::string logLevelToString(LogLevel level);
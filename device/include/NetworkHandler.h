@@ -10,10 +10,9 @@ class NetworkHandler {
 private:
     CommandHandler& commandHandler;
     int tcpPort;
-    std::string multicastIP = "239.255.255.250";
-    int multicastPort = 1900;
 
     bool stopFlag = false;
+    uint64_t changeListenerId = 0; // Bursts discovery announcements on state changes
 
 public:
     NetworkHandler(CommandHandler& commandHandler, int tcpPort);
@@ -23,7 +22,6 @@ public:
     void stop();
 
 private:
-    void udpDiscovery();
     void tcpServer();
 
     int createServerSocket();
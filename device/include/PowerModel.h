@@ -0,0 +1,78 @@
+#ifndef POWER_MODEL_H
+#define POWER_MODEL_H
+
+#include <atomic>
+#include "DeviceState.h"
+
+// Computes a device's instantaneous draw in watts from its state and the
+// ambient temperature. Models are evaluated on every state transition, so
+// they must be cheap and free of side effects. A device type picks its model
+// in its constructor; Device::setPowerModel swaps in another one.
+class PowerModel {
+public:
+    virtual ~PowerModel() = default;
+
+    // Draw in `state`, on or off, with the room at `ambient` degrees Celsius
+    virtual int powerFor(const DeviceState& state, double ambient) const = 0;
+
+    // Simulated ambient temperature every device in the process sees. A change
+    // takes effect on each device's next state transition.
+    static double getAmbient();
+    static void setAmbient(double celsius);
+
+private:
+    static std::atomic<double> ambient;
+};
+
+// Fixed draw when on, plus standby draw when off (e.g. a light)
+class ConstantPowerModel : public PowerModel {
+public:
+    ConstantPowerModel(int onWatts, int standbyWatts = 0) : onWatts(onWatts), standbyWatts(standbyWatts) {}
+    int powerFor(const DeviceState& state, double ambient) const override;
+
+private:
+    int onWatts;
+    int standbyWatts;
+};
+
+// Fan motor: fixed losses plus a term cubic in speed (fan affinity law)
+class FanPowerModel : public PowerModel {
+public:
+    struct Parameters {
+        int standbyWatts = 1;
+        int lossWatts = 8;      // Motor and electronics at any speed
+        int ratedWatts = 52;    // Additional draw at maxSpeed
+        int maxSpeed = 3;
+    };
+
+    FanPowerModel() = default;
+    explicit FanPowerModel(const Parameters& parameters) : parameters(parameters) {}
+    int powerFor(const DeviceState& state, double ambient) const override;
+
+private:
+    Parameters parameters;
+};
+
+// Air conditioner: indoor fan plus a compressor whose duty cycle grows with the
+// gap between the ambient temperature and the setpoint. The compressor rests
+// once the room is past the setpoint; DRY runs it at a fixed low duty.
+class ACPowerModel : public PowerModel {
+public:
+    struct Parameters {
+        int standbyWatts = 3;
+        int fanWatts = 45;
+        int compressorWatts = 1200;
+        double minDuty = 0.2;        // Duty as soon as the compressor is needed
+        double dutyPerDegree = 0.1;  // Added per degree between ambient and setpoint
+        double dryDuty = 0.3;
+    };
+
+    ACPowerModel() = default;
+    explicit ACPowerModel(const Parameters& parameters) : parameters(parameters) {}
+    int powerFor(const DeviceState& state, double ambient) const override;
+
+private:
+    Parameters parameters;
+};
+
+#endif
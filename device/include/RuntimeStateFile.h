@@ -0,0 +1,55 @@
+#ifndef RUNTIME_STATE_FILE_H
+#define RUNTIME_STATE_FILE_H
+
+#include <string>
+#include <cstdint>
+
+// Memory-mapped checkpoint of the runtime counters. The file holds two slots
+// written alternately, each with a sequence number and checksum; a write torn
+// by a crash only damages the slot being written, so the other one is used.
+// Loading is a plain read of the mapped struct.
+class RuntimeStateFile {
+public:
+    struct Counters {
+        int64_t totalRuntimeMs = 0;
+        int64_t dailyRuntimeMs = 0;
+        int64_t monthlyRuntimeMs = 0;
+        int64_t yearlyRuntimeMs = 0;
+        int64_t cumulativeWattMs = 0;
+        int64_t lastUpdate = 0; // Epoch seconds
+    };
+
+    // Creates the file if needed; throws std::runtime_error on failure
+    explicit RuntimeStateFile(const std::string& path);
+    ~RuntimeStateFile();
+
+    RuntimeStateFile(const RuntimeStateFile&) = delete;
+    RuntimeStateFile& operator=(const RuntimeStateFile&) = delete;
+
+    // Newest intact checkpoint; false if there is none
+    bool load(Counters& counters) const;
+    void store(const Counters& counters);
+
+private:
+    struct Slot {
+        uint64_t sequence;
+        Counters counters;
+        uint32_t checksum;
+        uint32_t reserved;
+    };
+
+    struct Layout {
+        uint32_t magic;
+        uint32_t version;
+        Slot slots[2];
+    };
+
+    int fd = -1;
+    Layout* layout = nullptr;
+    uint64_t sequence = 0;
+
+    static uint32_t checksum(const Slot& slot);
+    const Slot* newestSlot() const;
+};
+
+#endif
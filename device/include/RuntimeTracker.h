@@ -1,36 +1,121 @@
 #ifndef RUNTIMETRACKER_H
 #define RUNTIMETRACKER_H
 
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <ctime>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include "EnergyHistory.h"
+#include "RuntimeStateFile.h"
 
 class RuntimeTracker {
+public:
+    // Time source of a tracker; the default reads the system clocks. Tests
+    // pass their own to step through days, months and years.
+    class Clock {
+    public:
+        virtual ~Clock() = default;
+        virtual std::chrono::steady_clock::time_point steadyNow() const = 0;
+        virtual int64_t wallNowMs() const = 0; // Epoch milliseconds
+    };
+
+    // Consistent view of the counters including the session in progress
+    struct Totals {
+        int64_t totalRuntimeMs = 0;
+        int64_t dailyRuntimeMs = 0;
+        int64_t monthlyRuntimeMs = 0;
+        int64_t yearlyRuntimeMs = 0;
+        int64_t cumulativeWattMs = 0;
+    };
+
 private:
-    int totalRuntime = 0;                  // Total runtime in seconds
-    int dailyRuntime = 0;                  // Daily runtime in seconds
-    int monthlyRuntime = 0;                // Monthly runtime in seconds
-    int yearlyRuntime = 0;                 // Yearly runtime in seconds
-    int cumulativePowerConsumption = 0;    // Total power consumption in Watts
-    int currentPower = 0;                  // Current power consumption in Watts
-
-    std::chrono::time_point<std::chrono::system_clock> lastStartTime; // Timer start
+    int64_t totalRuntimeMs = 0;            // Total runtime in milliseconds
+    int64_t dailyRuntimeMs = 0;            // Daily runtime in milliseconds
+    int64_t monthlyRuntimeMs = 0;          // Monthly runtime in milliseconds
+    int64_t yearlyRuntimeMs = 0;           // Yearly runtime in milliseconds
+    int64_t cumulativeWattMs = 0;          // Total energy in watt-milliseconds
+    int currentPower = 0;                  // Current draw in Watts, standby included
+
+    // Session time on the monotonic clock, so NTP adjustments do not
+    // stretch or shrink the measured durations
+    std::chrono::steady_clock::time_point accountedSince; // Counters include the session up to here
     std::time_t lastUpdate;                // Last time the runtime was updated
 
-    void resetIfNewPeriod();
+    // Cached local-time starts of the next day, month and year
+    std::time_t nextDayStart = 0;
+    std::time_t nextMonthStart = 0;
+    std::time_t nextYearStart = 0;
+
+    // Guards the counters, history and checkpoints against concurrent
+    // timer and network threads
+    std::mutex mutex;
+
+    // The running session is accounted lazily, up to the current time, on
+    // every state change, tick and history query. Energy integrates the
+    // draw piecewise whether on or off; runtime and history only count while on.
+    EnergyHistory history;
+    bool running = false;
+
+    // Seqlock-published copy of the counters and the running session, so
+    // readers never take the mutex. The sequence is odd while a writer is
+    // updating; readers retry until they see the same even value around
+    // their reads. Fields are relaxed atomics to keep concurrent reads defined.
+    struct Published {
+        std::atomic<uint64_t> sequence{0};
+        std::atomic<int64_t> totalRuntimeMs{0};
+        std::atomic<int64_t> dailyRuntimeMs{0};
+        std::atomic<int64_t> monthlyRuntimeMs{0};
+        std::atomic<int64_t> yearlyRuntimeMs{0};
+        std::atomic<int64_t> cumulativeWattMs{0};
+        std::atomic<int64_t> accountedSinceNs{0}; // steady_clock
+        std::atomic<bool> sessionOn{false};
+        std::atomic<int> sessionPower{0};
+        std::atomic<int64_t> nextDayStart{0};
+        std::atomic<int64_t> nextMonthStart{0};
+        std::atomic<int64_t> nextYearStart{0};
+    };
+    Published published;
+
+    // Counters are checkpointed here whenever they change
+    std::unique_ptr<RuntimeStateFile> stateFile;
+
+    std::shared_ptr<const Clock> clock;
+
+    void setBoundariesLocked(std::time_t now);
+    void accountLocked();
+    void checkpointLocked();
+    void publishLocked();
 
 public:
-    RuntimeTracker();
+    // A null clock means the system clocks
+    explicit RuntimeTracker(std::shared_ptr<const Clock> clock = nullptr);
     ~RuntimeTracker();
 
-    // Power and runtime management
-    void startTimer(int power);
-    void stopTimer();
+    // Power and runtime management. Call on every change of the on flag or
+    // the draw; the previous draw is accounted up to now first.
+    void setState(bool on, int power);
     void updateRuntime();
 
-    int getDailyRuntime() const;
-    int getMonthlyRuntime() const;
-    int getYearlyRuntime() const;
-    int getCumulativePowerConsumption() const;
+    // Resumes the counters checkpointed in `path` and keeps checkpointing
+    // there. Returns false if the file held no valid checkpoint.
+    bool attachStateFile(const std::string& path);
+
+    // Lock-free; includes the session in progress up to now
+    Totals getTotals() const;
+
+    // Whole seconds and watt-seconds, as reported by `details`
+    int64_t getDailyRuntime() const;
+    int64_t getMonthlyRuntime() const;
+    int64_t getYearlyRuntime() const;
+    int64_t getCumulativePowerConsumption() const;
+
+    // History points overlapping [fromSeconds, toSeconds] (epoch seconds) at the
+    // coarsest stored resolution not exceeding `resolution` seconds
+    std::vector<EnergyHistory::Point> getHistory(int64_t fromSeconds, int64_t toSeconds, int64_t resolution);
 };
 
 #endif
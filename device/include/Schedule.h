@@ -0,0 +1,61 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <string>
+#include <chrono>
+#include <ctime>
+#include <cstdint>
+
+// Cron-like calendar expression: "minute hour day-of-month month day-of-week".
+// Each field accepts '*', numbers, ranges (a-b), lists (a,b) and steps (*/n, a-b/n).
+// Day-of-week is 0-7 with 0 and 7 meaning Sunday. Evaluated in local time.
+class CronExpression {
+private:
+    uint64_t minutes = 0;  // bits 0-59
+    uint32_t hours = 0;    // bits 0-23
+    uint32_t days = 0;     // bits 1-31
+    uint32_t months = 0;   // bits 0-11
+    uint32_t weekdays = 0; // bits 0-6
+    bool daysRestricted = false;
+    bool weekdaysRestricted = false;
+    std::string expression;
+
+    bool dayMatches(const std::tm& time) const;
+
+public:
+    CronExpression() = default;
+
+    // Throws std::invalid_argument on malformed expressions
+    static CronExpression parse(const std::string& expression);
+
+    // First matching minute strictly after `after`, or -1 if none within five years.
+    // Jumps field by field instead of scanning minute by minute.
+    std::time_t next(std::time_t after) const;
+
+    const std::string& toString() const { return expression; }
+};
+
+// How a timer repeats after it first fires
+struct TimerSchedule {
+    enum class Kind { ONCE, INTERVAL, CRON };
+
+    Kind kind = Kind::ONCE;
+    int intervalSeconds = 0;
+    CronExpression cron;
+
+    static TimerSchedule every(int seconds);
+    static TimerSchedule calendar(const std::string& expression);
+
+    bool isRecurring() const { return kind != Kind::ONCE; }
+
+    // Deadline of the first occurrence when the schedule is created at `now`
+    std::chrono::steady_clock::time_point firstDeadline(std::chrono::steady_clock::time_point now) const;
+    // Deadline of the occurrence following one that was due at `previous`;
+    // occurrences already missed at `now` are skipped.
+    std::chrono::steady_clock::time_point nextDeadline(std::chrono::steady_clock::time_point previous,
+                                                       std::chrono::steady_clock::time_point now) const;
+
+    std::string describe() const;
+};
+
+#endif
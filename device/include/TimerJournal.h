@@ -0,0 +1,68 @@
+#ifndef TIMER_JOURNAL_H
+#define TIMER_JOURNAL_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include "Schedule.h"
+
+// What to do with timers whose deadline passed while the device was down
+enum class TimerCatchUp {
+    FIRE, // Fire overdue timers once, right after startup
+    SKIP  // Drop overdue one-shot timers; recurring ones move to their next occurrence
+};
+
+// Append-only on-disk log of timer changes with absolute (wall clock)
+// deadlines. Replaying it yields the live timers; compact() rewrites it with
+// only those once dead records dominate.
+class TimerJournal {
+public:
+    struct Entry {
+        uint64_t id;
+        int64_t deadlineMs; // Milliseconds since the Unix epoch
+        std::string action;
+        TimerSchedule schedule;
+    };
+
+    explicit TimerJournal(const std::string& path);
+    ~TimerJournal();
+
+    TimerJournal(const TimerJournal&) = delete;
+    TimerJournal& operator=(const TimerJournal&) = delete;
+
+    // Replays the journal; a torn record at the tail is ignored.
+    std::vector<Entry> load();
+
+    void recordAdd(const Entry& entry);   // Also used to move a timer's deadline
+    void recordRemove(uint64_t id);
+    void recordClear();
+
+    bool needsCompaction(size_t liveCount) const;
+    // Atomically replaces the journal with `live` (write-then-rename).
+    void compact(const std::vector<Entry>& live);
+
+private:
+    enum Op : uint8_t { ADD = 1, REMOVE = 2, CLEAR = 3 };
+
+    // Fixed-width record header, followed by the action and cron text
+    struct RecordHeader {
+        uint8_t op;
+        uint8_t kind;
+        uint16_t actionLength;
+        uint32_t param;     // Interval seconds, or cron text length
+        uint64_t id;
+        int64_t deadlineMs;
+    };
+
+    std::string path;
+    int fd = -1;
+    size_t recordCount = 0;
+    std::mutex mutex;
+
+    static void appendRecord(std::string& buffer, uint8_t op, const Entry& entry);
+    void writeLocked(const std::string& buffer);
+    void openForAppend();
+};
+
+#endif
@@ -2,39 +2,53 @@
 #define TIMER_MANAGER_H
 
 #include <functional>
-#include <queue>
-#include <thread>
-#include <mutex>
-#include <condition_variable>
 #include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include "TimerService.h"
+#include "TimerJournal.h"
 
-struct TimerRequest {
-    int duration; // Seconds
-    std::string action;
-};
-
+// Per-device handle onto the shared TimerService. Holds no thread of its own.
+// Optionally journals every change so pending timers survive restarts.
 class TimerManager {
 private:
-    std::queue<TimerRequest> timerQueue;
-    std::thread timerThread;
-    std::mutex timerMutex;
-    std::condition_variable timerCondition;
-    bool stopThread = false;
-    bool cancelCurrentTimer = false;
-
-    // Callback to execute actions
+    TimerService& service;
+    TimerService::OwnerId owner;
+
+    std::mutex mutex; // Orders journal records with the service operations they describe
     std::function<void(const std::string&)> actionCallback;
+    std::unique_ptr<TimerJournal> journal;
+    size_t journaledTimers = 0;
 
-    void timerThreadFunction();
+    void onTimerFired(const TimerInfo& timer);
+    void journalAddLocked(uint64_t id, TimerService::Clock::time_point deadline, const std::string& action,
+                          const TimerSchedule& schedule);
+    void compactJournalLocked();
 
 public:
-    TimerManager();
+    explicit TimerManager(TimerService& service = TimerService::getInstance());
     ~TimerManager();
 
-    void setTimer(int duration, const std::string& action);
+    TimerManager(const TimerManager&) = delete;
+    TimerManager& operator=(const TimerManager&) = delete;
+
+    // Returns the ID of the new timer
+    uint64_t setTimer(int duration, const std::string& action);
+    // Recurring timer; first fires at the schedule's next occurrence
+    uint64_t setSchedule(const TimerSchedule& schedule, const std::string& action);
+    bool cancelTimer(uint64_t id);
     void cancelAllTimers();
+    std::vector<TimerInfo> listTimers();
 
     void registerCallback(const std::function<void(const std::string&)>& callback);
+    // Restores the timers journaled at `path` (applying `catchUp` to overdue
+    // ones) and journals every change from now on. Returns the number restored.
+    size_t enablePersistence(const std::string& path, TimerCatchUp catchUp);
+    // Cancels all timers and waits for a running action to finish;
+    // no callback is invoked afterwards.
+    void detach();
 };
 
 #endif
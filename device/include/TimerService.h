@@ -0,0 +1,141 @@
+#ifndef TIMER_SERVICE_H
+#define TIMER_SERVICE_H
+
+#include <functional>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <memory>
+#include "Schedule.h"
+
+// Pending timer as reported to callers
+struct TimerInfo {
+    uint64_t id;
+    std::chrono::steady_clock::time_point deadline;
+    std::string action;
+    std::shared_ptr<const TimerSchedule> recurrence; // Null for one-shot timers
+};
+
+// Timer to add through TimerService::scheduleBatch
+struct TimerRequest {
+    std::chrono::steady_clock::time_point deadline;
+    std::string action;
+    std::shared_ptr<const TimerSchedule> recurrence;
+};
+
+// Process-wide timer scheduler shared by every device. Timers live in one
+// deadline-ordered min-heap served by a small, configurable pool of dispatch
+// threads that is only started when the first timer is scheduled, so idle
+// devices cost no threads. Devices talk to it through TimerManager handles.
+class TimerService {
+public:
+    using OwnerId = uint64_t;
+    using TimerId = uint64_t;
+    using Clock = std::chrono::steady_clock;
+    // Receives the fired timer; for recurring timers `deadline` is already
+    // the next occurrence.
+    using Callback = std::function<void(const TimerInfo&)>;
+
+    static TimerService& getInstance();
+    // Number of dispatch threads; must be called before getInstance() is first used.
+    // Zero selects inline mode: no threads are started and timers are
+    // dispatched by an event loop watching getEventFd().
+    static void configure(size_t dispatchThreads);
+
+    explicit TimerService(size_t dispatchThreads = 1);
+    ~TimerService();
+
+    OwnerId registerOwner();
+    // Cancels the owner's timers and waits for its in-flight callbacks.
+    void unregisterOwner(OwnerId owner);
+    void setCallback(OwnerId owner, const Callback& callback);
+
+    // Returns the new timer's ID, or 0 if the owner is unknown. Recurring
+    // timers keep their ID and are re-armed from `recurrence` each time they fire.
+    TimerId schedule(OwnerId owner, Clock::time_point deadline, const std::string& action,
+                     std::shared_ptr<const TimerSchedule> recurrence = nullptr);
+    // Adds many timers with a single O(n) heap rebuild; returns their IDs in order.
+    std::vector<TimerId> scheduleBatch(OwnerId owner, std::vector<TimerRequest> requests);
+    // Returns false if the timer does not exist or belongs to another owner.
+    bool cancel(OwnerId owner, TimerId id);
+    void cancelAll(OwnerId owner);
+    bool isPending(OwnerId owner, TimerId id);
+    // Pending timers of the owner, ordered by deadline.
+    std::vector<TimerInfo> list(OwnerId owner);
+
+    // Inline mode: a timerfd that becomes readable when the earliest timer
+    // is due (-1 in threaded mode). The event loop then calls dispatchDue(),
+    // which runs the due actions on the calling thread.
+    int getEventFd() const { return timerFd; }
+    size_t dispatchDue();
+
+private:
+    // Heap entries stay small; the timer body lives in the `timers` index.
+    struct Entry {
+        Clock::time_point deadline;
+        TimerId id; // Monotonic, so it also keeps FIFO order for equal deadlines
+    };
+
+    // Orders the heap as a min-heap on (deadline, id)
+    struct EntryLater {
+        bool operator()(const Entry& a, const Entry& b) const {
+            if (a.deadline != b.deadline) return a.deadline > b.deadline;
+            return a.id > b.id;
+        }
+    };
+
+    struct TimerRecord {
+        OwnerId owner;
+        Clock::time_point deadline;
+        std::string action;
+        std::shared_ptr<const TimerSchedule> recurrence;
+    };
+
+    struct OwnerState {
+        Callback callback;
+        std::unordered_set<TimerId> timers; // Pending timers of this owner
+        int running = 0;                    // Callbacks currently executing
+    };
+
+    // Cancelled timers are removed from the index in O(1) and their heap
+    // entries are dropped lazily when popped or compacted.
+    std::vector<Entry> heap;
+    size_t staleEntries = 0;
+    std::unordered_map<TimerId, TimerRecord> timers;
+    std::unordered_map<OwnerId, OwnerState> owners;
+    OwnerId nextOwner = 1;
+    TimerId nextTimer = 1;
+
+    // A timer popped from the heap, ready to run
+    struct Dispatch {
+        OwnerId owner = 0;
+        TimerInfo timer;
+        Callback callback;
+    };
+
+    size_t dispatchThreads;
+    int timerFd = -1;
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wakeCondition;
+    std::condition_variable idleCondition;
+    bool stopping = false;
+
+    static size_t configuredThreads;
+
+    void cancelAllLocked(OwnerState& state);
+    void startThreadsLocked();
+    void armLocked();
+    bool takeDueLocked(Clock::time_point now, Dispatch& dispatch);
+    void runLocked(std::unique_lock<std::mutex>& lock, const Dispatch& dispatch);
+    void compactLocked();
+    void dispatchThreadFunction();
+};
+
+#endif
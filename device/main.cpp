@@ -1,21 +1,61 @@
 #include <iostream>
 #include <memory>
 #include <string>
-#include "Light.h"
-#include "Fan.h"
-#include "AC.h"
+#include <sys/stat.h>
+#include <vector>
+#include "DeviceRegistry.h"
 #include "CommandHandler.h"
 #include "NetworkHandler.h"
+#include "LogSink.h"
+#include "TimerService.h"
+#include "PowerModel.h"
+#include "DeviceSnapshot.h"
+#include "DiscoveryService.h"
 
 // Helper function to display usage
 void printUsage() {
-    std::cout << "Usage: ./device --type <device_type> --id <device_id> --password <password> --port <port>\n";
-    std::cout << "Supported device types: light, fan, ac\n";
+    std::cout << "Usage: ./device --type <device_type> --id <device_id> --password <password> --port <port> [--timer-threads <n>] [--timer-catchup fire|skip] [--ambient <celsius>] [--discovery json|binary] [--plugin <file.so>]... [--plugin-dir <dir>]...\n";
+    std::cout << "       ./device --list-types [--plugin <file.so>]... [--plugin-dir <dir>]...\n";
+    std::cout << "       ./device --demux-log <log_file> <output_dir>\n";
+    std::cout << "Supported device types:";
+    for (const auto* type : DeviceRegistry::getInstance().types()) {
+        std::cout << " " << type->name;
+    }
+    std::cout << "\n";
+}
+
+// Prints each registered type with its state fields, actions and power model
+void printDeviceTypes() {
+    for (const auto* type : DeviceRegistry::getInstance().types()) {
+        std::cout << type->name << "\n";
+        std::cout << "  power:   " << type->powerModel << "\n";
+        std::cout << "  fields: ";
+        for (const auto& field : type->stateFields) std::cout << " " << field;
+        std::cout << "\n  actions:";
+        for (const auto& action : type->actions) std::cout << " " << action.first;
+        std::cout << "\n";
+    }
 }
 
 int main(int argc, char* argv[]) {
     std::string deviceType, deviceId, password;
     int port = 0;
+    bool listTypes = false;
+    std::vector<std::string> plugins;
+    std::vector<std::string> pluginDirs;
+    TimerCatchUp timerCatchUp = TimerCatchUp::FIRE;
+
+    // Offline mode: split a shared log file into per-device files
+    if (argc == 4 && std::string(argv[1]) == "--demux-log") {
+        try {
+            size_t lines = LogSink::demultiplex(argv[2], argv[3]);
+            std::cout << "Wrote " << lines << " lines to " << argv[3] << "\n";
+            return 0;
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+    }
 
     // Parse command-line arguments
     for (int i = 1; i < argc; ++i) {
@@ -28,12 +68,66 @@ int main(int argc, char* argv[]) {
             password = argv[++i];
         } else if (arg == "--port" && i + 1 < argc) {
             port = std::stoi(argv[++i]);
+        } else if (arg == "--timer-threads" && i + 1 < argc) {
+            int threads = std::stoi(argv[++i]);
+            if (threads < 0) {
+                printUsage();
+                return 1;
+            }
+            TimerService::configure(threads);
+        } else if (arg == "--discovery" && i + 1 < argc) {
+            std::string encoding = argv[++i];
+            if (encoding == "json") {
+                DiscoveryService::getInstance().setEncoding(DiscoveryService::Encoding::JSON);
+            } else if (encoding == "binary") {
+                DiscoveryService::getInstance().setEncoding(DiscoveryService::Encoding::BINARY);
+            } else {
+                printUsage();
+                return 1;
+            }
+        } else if (arg == "--ambient" && i + 1 < argc) {
+            PowerModel::setAmbient(std::stod(argv[++i]));
+        } else if (arg == "--plugin" && i + 1 < argc) {
+            plugins.push_back(argv[++i]);
+        } else if (arg == "--plugin-dir" && i + 1 < argc) {
+            pluginDirs.push_back(argv[++i]);
+        } else if (arg == "--list-types") {
+            listTypes = true;
+        } else if (arg == "--timer-catchup" && i + 1 < argc) {
+            std::string policy = argv[++i];
+            if (policy == "fire") {
+                timerCatchUp = TimerCatchUp::FIRE;
+            } else if (policy == "skip") {
+                timerCatchUp = TimerCatchUp::SKIP;
+            } else {
+                printUsage();
+                return 1;
+            }
         } else {
             printUsage();
             return 1;
         }
     }
 
+    // Device types from plugins; only those named on the command line are
+    // loaded, since loading one runs its code
+    DeviceRegistry& registry = DeviceRegistry::getInstance();
+    try {
+        for (const auto& directory : pluginDirs) {
+            registry.loadPluginDirectory(directory);
+        }
+        for (const auto& plugin : plugins) {
+            registry.loadPlugin(plugin);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    if (listTypes) {
+        printDeviceTypes();
+        return 0;
+    }
+
     // Validate required arguments
     if (deviceType.empty() || deviceId.empty() || password.empty() || port == 0) {
         std::cerr << "Error: Missing required arguments.\n";
@@ -43,21 +137,42 @@ int main(int argc, char* argv[]) {
 
     // Instantiate the appropriate device
     std::shared_ptr<Device> device;
-
-    if (deviceType == "light") {
-        device = std::make_shared<Light>(deviceId, password);
-    } else if (deviceType == "fan") {
-        device = std::make_shared<Fan>(deviceId, password);
-    } else if (deviceType == "ac") {
-        device = std::make_shared<AC>(deviceId, password);
-    } else {
-        std::cerr << "Error: Unsupported device type \"" << deviceType << "\".\n";
+    try {
+        device = registry.create(deviceType, deviceId, password);
+    } catch (const std::invalid_argument& e) {
+        std::cerr << "Error: " << e.what() << ".\n";
         printUsage();
         return 1;
     }
 
+    // Restore counters, state and timers saved by a previous run before accepting commands
+    mkdir("data", 0755);
+    try {
+        device->enableRuntimePersistence("data/runtime_" + deviceId + ".state");
+    } catch (const std::exception& e) {
+        std::cerr << "Warning: runtime counters will not persist: " << e.what() << "\n";
+    }
+
+    // Warm restart: bring back the state and password of the previous run
+    DeviceSnapshot snapshot("data/snapshot_" + deviceId + ".bin");
+    auto saved = snapshot.load();
+    auto record = saved.find(deviceId);
+    if (record != saved.end() && record->second.type == device->getType()) {
+        device->restoreState(DeviceState::unpack(record->second.state));
+        password = record->second.password;
+    }
+
+    // Timers last: overdue ones may fire right away and must act on the restored state
+    try {
+        device->enableTimerPersistence("data/timers_" + deviceId + ".journal", timerCatchUp);
+    } catch (const std::exception& e) {
+        std::cerr << "Warning: timers will not persist: " << e.what() << "\n";
+    }
+
     // Create CommandHandler and NetworkHandler
     CommandHandler commandHandler(device, password);
+    snapshot.track(device, commandHandler, password);
+    snapshot.start();
     NetworkHandler networkHandler(commandHandler, port);
 
     // Start the network handler
@@ -0,0 +1,54 @@
+// Example device type plugin: a space heater with three heat levels.
+// Build with `make plugins`, then load with `--plugin plugins/Heater.so` or `--plugin-dir plugins`.
+#include "DeviceRegistry.h"
+#include <stdexcept>
+
+using json = nlohmann::json;
+
+class Heater : public Device {
+protected:
+    int powerFor(const DeviceState& state) const override {
+        return state.on ? 500 * state.speed : 0;
+    }
+    void prepareTurnOn(DeviceState& state) const override {
+        if (state.speed == 0) state.speed = 1;
+    }
+    void addDetails(const DeviceState& state, json& details) const override {
+        details["level"] = state.speed;
+    }
+
+public:
+    using Device::Device;
+
+    void setLevel(int level) {
+        if (level < 1 || level > 3) throw std::runtime_error("Invalid heat level.");
+        transition([level](DeviceState state) {
+            state.speed = level;
+            return state;
+        });
+    }
+
+    std::string getType() const override {
+        return "Heater";
+    }
+};
+
+extern "C" void registerDeviceTypes(DeviceRegistry& registry) {
+    DeviceTypeInfo heater;
+    heater.name = "Heater";
+    heater.stateFields = {"level"};
+    heater.powerModel = "500 W per heat level when on";
+    heater.actions["set_level"] = [](Device& device, const json& command) -> json {
+        int level = command.at("level");
+        device.getLogger().logInfo(device.getId(), "Setting heat level to: " + std::to_string(level));
+        static_cast<Heater&>(device).setLevel(level);
+        return {
+            {"status", 200},
+            {"message", "Heat level set successfully"}
+        };
+    };
+    heater.create = [](const std::string& id, const std::string& password) {
+        return std::make_shared<Heater>(id, password);
+    };
+    registry.registerType(std::move(heater));
+}
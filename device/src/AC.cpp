@@ -2,35 +2,29 @@
 #include <stdexcept>
 
 AC::AC(const std::string& id, const std::string& password)
-    : Device(id, password) {}
-
-void AC::turnOn() {
-    if (state) throw std::runtime_error("AC is already on.");
-    state = true;
-    powerConsumption = 100;
-    runtimeTracker.startTimer(powerConsumption);
-}
-
-void AC::turnOff() {
-    if (!state) throw std::runtime_error("AC is already off.");
-    state = false;
-    powerConsumption = 0;
-    runtimeTracker.stopTimer();
+    : Device(id, password) {
+    setPowerModel(std::make_shared<ACPowerModel>());
 }
 
 void AC::setMode(ACMode newMode) {
-    mode = newMode;
+    transition([newMode](DeviceState state) {
+        state.mode = static_cast<int>(newMode);
+        return state;
+    });
 }
 
 void AC::setTemperature(int newTemperature) {
     if (newTemperature < 18 || newTemperature > 30) throw std::runtime_error("Temperature out of range.");
-    temperature = newTemperature;
+    transition([newTemperature](DeviceState state) {
+        state.temperature = newTemperature;
+        return state;
+    });
 }
 
 ACMode AC::getMode() const {
-    return mode;
+    return static_cast<ACMode>(getState().mode);
 }
 
 int AC::getTemperature() const {
-    return temperature;
+    return getState().temperature;
 }
@@ -0,0 +1,67 @@
+#include "../include/DeviceRegistry.h"
+#include "../include/Light.h"
+#include "../include/Fan.h"
+#include "../include/AC.h"
+#include <stdexcept>
+
+using json = nlohmann::json;
+
+void registerBuiltinDeviceTypes(DeviceRegistry& registry) {
+    DeviceTypeInfo light;
+    light.name = "Light";
+    light.powerModel = "10 W when on";
+    light.create = [](const std::string& id, const std::string& password) {
+        return std::make_shared<Light>(id, password);
+    };
+    registry.registerType(std::move(light));
+
+    DeviceTypeInfo fan;
+    fan.name = "Fan";
+    fan.stateFields = {"speed"};
+    fan.powerModel = "8 W plus up to 52 W cubic in speed when on, 1 W standby";
+    fan.actions["set_speed"] = [](Device& device, const json& command) -> json {
+        int speed = command.at("speed");
+        device.getLogger().logInfo(device.getId(), "Setting fan speed to: " + std::to_string(speed));
+        static_cast<Fan&>(device).setSpeed(speed);
+        return {
+            {"status", 200},
+            {"message", "Fan speed set successfully"}
+        };
+    };
+    fan.create = [](const std::string& id, const std::string& password) {
+        return std::make_shared<Fan>(id, password);
+    };
+    registry.registerType(std::move(fan));
+
+    DeviceTypeInfo ac;
+    ac.name = "AC";
+    ac.stateFields = {"mode", "temperature"};
+    ac.powerModel = "45 W fan plus a 1200 W compressor cycled by the gap between ambient and setpoint, 3 W standby";
+    ac.actions["set_mode"] = [](Device& device, const json& command) -> json {
+        std::string mode = command.at("mode");
+        device.getLogger().logInfo(device.getId(), "Setting AC mode to: " + mode);
+        AC& airConditioner = static_cast<AC&>(device);
+        if (mode == "cool") airConditioner.setMode(ACMode::COOL);
+        else if (mode == "heat") airConditioner.setMode(ACMode::HEAT);
+        else if (mode == "dry") airConditioner.setMode(ACMode::DRY);
+        else throw std::invalid_argument("Invalid AC mode: " + mode);
+
+        return {
+            {"status", 200},
+            {"message", "AC mode set successfully"}
+        };
+    };
+    ac.actions["set_temperature"] = [](Device& device, const json& command) -> json {
+        int temperature = command.at("temperature");
+        device.getLogger().logInfo(device.getId(), "Setting AC temperature to: " + std::to_string(temperature));
+        static_cast<AC&>(device).setTemperature(temperature);
+        return {
+            {"status", 200},
+            {"message", "AC temperature set successfully"}
+        };
+    };
+    ac.create = [](const std::string& id, const std::string& password) {
+        return std::make_shared<AC>(id, password);
+    };
+    registry.registerType(std::move(ac));
+}
@@ -1,11 +1,13 @@
 #include "../include/CommandHandler.h"
 #include <stdexcept>
 #include <iostream>
+#include <ctime>
 
 using json = nlohmann::json;
 
 CommandHandler::CommandHandler(std::shared_ptr<Device> device, const std::string& password)
-    : device(std::move(device)), authManager(password) {}
+    : device(std::move(device)), authManager(password),
+      typeInfo(DeviceRegistry::getInstance().find(this->device->getType())) {}
 
 json CommandHandler::handleCommand(const json& commandJson) {
     Logger& logger = device->getLogger();
@@ -27,7 +29,11 @@ json CommandHandler::handleCommand(const json& commandJson) {
             return authManager.validateToken(commandJson);
         } else if (action == "change_password") {
             logger.logInfo(device->getId(), "Changing password for client: " + commandJson["clientId"].get<std::string>());
-            return authManager.changePassword(commandJson);
+            json response = authManager.changePassword(commandJson);
+            if (response["status"] == 200 && passwordListener) {
+                passwordListener(commandJson["newPassword"].get<std::string>());
+            }
+            return response;
         }
 
         // Validate token before executing device-related commands
@@ -52,6 +58,20 @@ json CommandHandler::handleCommand(const json& commandJson) {
                 {"message", "Detailed info retrieved successfully"},
                 {"data", device->getDetailedInfo()}
             };
+        } else if (action == "history") {
+            // Range in epoch seconds; defaults to the last hour
+            int64_t to = commandJson.value("to", static_cast<int64_t>(std::time(nullptr)));
+            int64_t from = commandJson.value("from", to - 3600);
+            int64_t resolution = commandJson.value("resolution", static_cast<int64_t>(60));
+            if (from > to) {
+                throw std::invalid_argument("History range is empty");
+            }
+            logger.logDebug(device->getId(), "Fetching history for device: " + device->getId());
+            return {
+                {"status", 200},
+                {"message", "History retrieved successfully"},
+                {"history", device->getHistory(from, to, resolution)}
+            };
         } else if (action == "turn_on") {
             logger.logInfo(device->getId(), "Turning device ON");
             device->turnOn();
@@ -73,10 +93,51 @@ json CommandHandler::handleCommand(const json& commandJson) {
                 throw std::invalid_argument("Unsupported timer action: " + timerAction);
             }
             logger.logInfo(device->getId(), "Setting timer for " + std::to_string(duration) + " seconds with action: " + timerAction);
-            device->setTimer(duration, timerAction);
+            uint64_t timerId = device->setTimer(duration, timerAction);
+            return {
+                {"status", 200},
+                {"message", "Timer set successfully"},
+                {"timer_id", timerId}
+            };
+        } else if (action == "set_schedule") {
+            std::string timerAction = commandJson.at("timer_action");
+            if (timerAction != "turn_on" && timerAction != "turn_off") {
+                throw std::invalid_argument("Unsupported timer action: " + timerAction);
+            }
+            TimerSchedule schedule;
+            if (commandJson.contains("cron")) {
+                schedule = TimerSchedule::calendar(commandJson.at("cron").get<std::string>());
+            } else if (commandJson.contains("interval")) {
+                schedule = TimerSchedule::every(commandJson.at("interval").get<int>());
+            } else {
+                throw std::invalid_argument("set_schedule requires \"interval\" or \"cron\"");
+            }
+            logger.logInfo(device->getId(), "Setting schedule " + schedule.describe() + " with action: " + timerAction);
+            uint64_t timerId = device->setSchedule(schedule, timerAction);
+            return {
+                {"status", 200},
+                {"message", "Schedule set successfully"},
+                {"timer_id", timerId}
+            };
+        } else if (action == "list_timers") {
+            logger.logDebug(device->getId(), "Listing timers for device: " + device->getId());
+            return {
+                {"status", 200},
+                {"message", "Timers retrieved successfully"},
+                {"timers", device->listTimers()}
+            };
+        } else if (action == "cancel_timer") {
+            uint64_t timerId = commandJson.at("timer_id");
+            logger.logInfo(device->getId(), "Canceling timer " + std::to_string(timerId));
+            if (!device->cancelTimer(timerId)) {
+                return {
+                    {"status", 404},
+                    {"message", "Timer not found"}
+                };
+            }
             return {
                 {"status", 200},
-                {"message", "Timer set successfully"}
+                {"message", "Timer canceled"}
             };
         } else if (action == "cancel_timers") {
             logger.logInfo(device->getId(), "Canceling all timers for device: " + device->getId());
@@ -87,47 +148,14 @@ json CommandHandler::handleCommand(const json& commandJson) {
             };
         }
 
-        // Device-specific actions
-        if (auto fan = std::dynamic_pointer_cast<Fan>(device)) {
-            if (action == "set_speed") {
-                int speed = commandJson.at("speed");
-                logger.logInfo(device->getId(), "Setting fan speed to: " + std::to_string(speed));
-                fan->setSpeed(speed);
-                return {
-                    {"status", 200},
-                    {"message", "Fan speed set successfully"}
-                };
-            }
-            logger.logError(device->getId(), "Unsupported action for Fan: " + action);
-            throw std::invalid_argument("Unsupported action for Fan: " + action);
-        } else if (auto ac = std::dynamic_pointer_cast<AC>(device)) {
-            if (action == "set_mode") {
-                std::string mode = commandJson.at("mode");
-                logger.logInfo(device->getId(), "Setting AC mode to: " + mode);
-                if (mode == "cool") ac->setMode(ACMode::COOL);
-                else if (mode == "heat") ac->setMode(ACMode::HEAT);
-                else if (mode == "dry") ac->setMode(ACMode::DRY);
-                else throw std::invalid_argument("Invalid AC mode: " + mode);
-
-                return {
-                    {"status", 200},
-                    {"message", "AC mode set successfully"}
-                };
-            } else if (action == "set_temperature") {
-                int temperature = commandJson.at("temperature");
-                logger.logInfo(device->getId(), "Setting AC temperature to: " + std::to_string(temperature));
-                ac->setTemperature(temperature);
-                return {
-                    {"status", 200},
-                    {"message", "AC temperature set successfully"}
-                };
+        // Type-specific actions, looked up in the table of the device's type
+        if (typeInfo) {
+            auto handler = typeInfo->actions.find(action);
+            if (handler != typeInfo->actions.end()) {
+                return handler->second(*device, commandJson);
             }
-            logger.logError(device->getId(), "Unsupported action for AC: " + action);
-            throw std::invalid_argument("Unsupported action for AC: " + action);
-        } else if (auto light = std::dynamic_pointer_cast<Light>(device)) {
-            logger.logError(device->getId(), "Unsupported action for Light: " + action);
-            // No additional Light-specific actions for now
-            throw std::invalid_argument("Unsupported action for Light: " + action);
+            logger.logError(device->getId(), "Unsupported action for " + typeInfo->name + ": " + action);
+            throw std::invalid_argument("Unsupported action for " + typeInfo->name + ": " + action);
         }
 
         // Handle unsupported actions
@@ -11,7 +11,9 @@ using json = nlohmann::json;
 // Initializes the device with a unique ID and a password.
 // Registers timer callbacks to handle scheduled "turn on" or "turn off" actions.
 Device::Device(const std::string &id, const std::string &password)
-    : id(id), logger("log/device_" + id + ".log") {
+    : id(id), tableSlot(DeviceTable::getInstance().allocate()),
+      powerModel(std::make_shared<ConstantPowerModel>(10)), logger(LogSink::getShared()) {
+    DeviceTable::getInstance().update(tableSlot, getState());
     timerManager.registerCallback([this](const std::string& action) {
         try {
             if (action == "turn_on") {
@@ -28,17 +30,23 @@ Device::Device(const std::string &id, const std::string &password)
 }
 
 // Destructor
-// Ensures proper cleanup of device resources.
-Device::~Device() = default;
+// Timers should already be detached by the owner (see detachTimers); this is
+// only a fallback for devices constructed directly. Then gives up its table row.
+Device::~Device() {
+    timerManager.detach();
+    DeviceTable::getInstance().release(tableSlot);
+}
 
 // turnOn
 // Changes the device state to "on" and starts runtime tracking.
-// Throws an exception if the device is already on.
+// Throws an exception if the device is already on; of two concurrent calls exactly one succeeds.
 void Device::turnOn() {
-    if (state) throw std::runtime_error("Device is already on.");
-    state = true;
-    powerConsumption = 10; // Example power consumption in watts.
-    runtimeTracker.startTimer(powerConsumption);
+    transition([this](DeviceState state) {
+        if (state.on) throw std::runtime_error(getType() + " is already on.");
+        state.on = true;
+        prepareTurnOn(state);
+        return state;
+    });
     logger.logEvent(id, "Device turned on.");
 }
 
@@ -46,19 +54,91 @@ void Device::turnOn() {
 // Changes the device state to "off" and stops runtime tracking.
 // Throws an exception if the device is already off.
 void Device::turnOff() {
-    if (!state) throw std::runtime_error("Device is already off.");
-    state = false;
-    runtimeTracker.stopTimer();
-    powerConsumption = 0;
+    transition([this](DeviceState state) {
+        if (!state.on) throw std::runtime_error(getType() + " is already off.");
+        state.on = false;
+        return state;
+    });
     logger.logEvent(id, "Device turned off.");
 }
 
+// powerFor
+// Evaluates the power model at the current simulated ambient temperature.
+int Device::powerFor(const DeviceState& state) const {
+    return powerModel->powerFor(state, PowerModel::getAmbient());
+}
+
+// setPowerModel
+// Installs a new power model; the identity transition recomputes the draw.
+void Device::setPowerModel(std::shared_ptr<const PowerModel> model) {
+    powerModel = std::move(model);
+    transition([](DeviceState state) { return state; });
+}
+
+// syncTracker
+// Brings the runtime tracker and the device table in line with the latest
+// state word. Whichever thread syncs last sees the final state, so both end
+// up matching it even when transitions from several threads race.
+void Device::syncTracker() {
+    std::lock_guard<std::mutex> lock(trackerMutex);
+    DeviceState current = getState();
+    DeviceTable::getInstance().update(tableSlot, current);
+    for (auto& listener : changeListeners) listener.second();
+    if (current.on == trackedOn && current.power == trackedPower) return;
+    runtimeTracker.setState(current.on, current.power);
+    trackedOn = current.on;
+    trackedPower = current.power;
+}
+
+// restoreState
+// Replaces the whole state word; the draw is recomputed and runtime tracking
+// resumes if the saved state was on.
+void Device::restoreState(const DeviceState& state) {
+    transition([&state](DeviceState) { return state; });
+    logger.logEvent(id, std::string("State restored: ") + (state.on ? "on" : "off"));
+}
+
+// addChangeListener
+uint64_t Device::addChangeListener(std::function<void()> listener) {
+    std::lock_guard<std::mutex> lock(trackerMutex);
+    changeListeners.emplace_back(nextListenerId, std::move(listener));
+    return nextListenerId++;
+}
+
+// removeChangeListener
+void Device::removeChangeListener(uint64_t listenerId) {
+    std::lock_guard<std::mutex> lock(trackerMutex);
+    changeListeners.erase(std::remove_if(changeListeners.begin(), changeListeners.end(),
+                                         [listenerId](const auto& listener) { return listener.first == listenerId; }),
+                          changeListeners.end());
+}
+
 // setTimer
 // Schedules a "turn on" or "turn off" action after the specified duration.
-// Logs the timer configuration.
-void Device::setTimer(int duration, const std::string& action) {
-    timerManager.setTimer(duration, action);
-    logger.logEvent(id, "Timer set for " + std::to_string(duration) + " seconds to execute: " + action);
+// Logs the timer configuration and returns the new timer's ID.
+uint64_t Device::setTimer(int duration, const std::string& action) {
+    uint64_t timerId = timerManager.setTimer(duration, action);
+    logger.logEvent(id, "Timer " + std::to_string(timerId) + " set for " + std::to_string(duration) + " seconds to execute: " + action);
+    return timerId;
+}
+
+// setSchedule
+// Schedules a recurring action (fixed interval or cron-like calendar).
+// Returns the timer's ID, which stays the same across occurrences.
+uint64_t Device::setSchedule(const TimerSchedule& schedule, const std::string& action) {
+    uint64_t timerId = timerManager.setSchedule(schedule, action);
+    logger.logEvent(id, "Timer " + std::to_string(timerId) + " scheduled " + schedule.describe() + " to execute: " + action);
+    return timerId;
+}
+
+// cancelTimer
+// Cancels a single pending timer. Returns false if no such timer exists.
+bool Device::cancelTimer(uint64_t timerId) {
+    bool canceled = timerManager.cancelTimer(timerId);
+    if (canceled) {
+        logger.logEvent(id, "Timer " + std::to_string(timerId) + " canceled.");
+    }
+    return canceled;
 }
 
 // cancelAllTimers
@@ -69,28 +149,90 @@ void Device::cancelAllTimers() {
     logger.logEvent(id, "All timers canceled.");
 }
 
+// detachTimers
+// Detaches from the shared timer service so no timer action can run against
+// a partially destroyed device.
+void Device::detachTimers() {
+    timerManager.detach();
+}
+
+// enableTimerPersistence
+// Restores timers journaled by a previous run and journals all changes from now on.
+size_t Device::enableTimerPersistence(const std::string& journalPath, TimerCatchUp catchUp) {
+    size_t restored = timerManager.enablePersistence(journalPath, catchUp);
+    logger.logEvent(id, "Restored " + std::to_string(restored) + " timers from " + journalPath);
+    return restored;
+}
+
+// enableRuntimePersistence
+// Resumes the runtime and energy counters saved by a previous run.
+void Device::enableRuntimePersistence(const std::string& statePath) {
+    if (runtimeTracker.attachStateFile(statePath)) {
+        logger.logEvent(id, "Resumed runtime counters from " + statePath);
+    }
+}
+
+// listTimers
+// Returns the pending timers, earliest first, with their remaining time in seconds.
+json Device::listTimers() {
+    json timers = json::array();
+    auto now = TimerService::Clock::now();
+    for (const auto& timer : timerManager.listTimers()) {
+        auto remaining = std::chrono::ceil<std::chrono::seconds>(timer.deadline - now).count();
+        timers.push_back({
+            {"id", timer.id},
+            {"action", timer.action},
+            {"remaining", remaining < 0 ? 0 : remaining},
+            {"recurring", timer.recurrence != nullptr},
+            {"schedule", timer.recurrence ? timer.recurrence->describe() : "once"}
+        });
+    }
+    return timers;
+}
+
 // getInfo
 // Returns basic information about the device (ID, state, power consumption) as a JSON object.
 json Device::getInfo() const {
+    DeviceState state = getState();
     return {
         {"id", id},
-        {"state", state ? "on" : "off"},
-        {"power", powerConsumption}
+        {"state", state.on ? "on" : "off"},
+        {"power", state.power}
     };
 }
 
 // getDetailedInfo
 // Returns detailed information about the device, including runtime statistics and cumulative power consumption.
+// The figures include the session in progress and come from one snapshot.
 json Device::getDetailedInfo() const {
-    return {
+    DeviceState state = getState();
+    RuntimeTracker::Totals totals = runtimeTracker.getTotals();
+    json details = {
         {"id", id},
-        {"state", state ? "on" : "off"},
-        {"power", powerConsumption},
-        {"cumulative_power", runtimeTracker.getCumulativePowerConsumption()},
+        {"state", state.on ? "on" : "off"},
+        {"power", state.power},
+        {"cumulative_power", totals.cumulativeWattMs / 1000},
         {"runtime", {
-            {"daily", runtimeTracker.getDailyRuntime()},
-            {"monthly", runtimeTracker.getMonthlyRuntime()},
-            {"yearly", runtimeTracker.getYearlyRuntime()}
+            {"daily", totals.dailyRuntimeMs / 1000},
+            {"monthly", totals.monthlyRuntimeMs / 1000},
+            {"yearly", totals.yearlyRuntimeMs / 1000}
         }}
     };
+    addDetails(state, details);
+    return details;
+}
+
+// getHistory
+// Returns the periods in [fromSeconds, toSeconds] during which the device was on.
+json Device::getHistory(int64_t fromSeconds, int64_t toSeconds, int64_t resolution) {
+    json samples = json::array();
+    for (const auto& point : runtimeTracker.getHistory(fromSeconds, toSeconds, resolution)) {
+        samples.push_back({
+            {"time", point.start},
+            {"period", point.period},
+            {"runtime", point.runtimeMs / 1000.0},
+            {"energy", point.wattSeconds}
+        });
+    }
+    return samples;
 }
@@ -0,0 +1,106 @@
+#include "../include/DeviceRegistry.h"
+#include <algorithm>
+#include <stdexcept>
+#include <iostream>
+#include <cctype>
+#include <dlfcn.h>
+#include <dirent.h>
+
+static std::string toLower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+    return text;
+}
+
+DeviceRegistry& DeviceRegistry::getInstance() {
+    static DeviceRegistry instance;
+    static bool builtinsRegistered = (registerBuiltinDeviceTypes(instance), true);
+    (void)builtinsRegistered;
+    return instance;
+}
+
+void DeviceRegistry::registerType(DeviceTypeInfo info) {
+    if (info.name.empty() || !info.create) {
+        throw std::invalid_argument("Device type needs a name and a factory");
+    }
+    std::string key = toLower(info.name);
+    if (typesByName.count(key)) {
+        throw std::invalid_argument("Device type already registered: " + info.name);
+    }
+    typesByName.emplace(key, std::make_unique<DeviceTypeInfo>(std::move(info)));
+}
+
+const DeviceTypeInfo* DeviceRegistry::find(const std::string& name) const {
+    auto it = typesByName.find(toLower(name));
+    return it == typesByName.end() ? nullptr : it->second.get();
+}
+
+std::shared_ptr<Device> DeviceRegistry::create(const std::string& name, const std::string& id, const std::string& password) const {
+    const DeviceTypeInfo* info = find(name);
+    if (!info) {
+        throw std::invalid_argument("Unsupported device type \"" + name + "\"");
+    }
+    // The returned owner detaches the device's timers while the whole object
+    // is still alive, before the concrete destructor runs
+    std::shared_ptr<Device> device = info->create(id, password);
+    if (!device) return device;
+    Device* raw = device.get();
+    return std::shared_ptr<Device>(raw, [device](Device* owned) mutable {
+        owned->detachTimers();
+        device.reset();
+    });
+}
+
+std::vector<const DeviceTypeInfo*> DeviceRegistry::types() const {
+    std::vector<const DeviceTypeInfo*> result;
+    for (const auto& entry : typesByName) {
+        result.push_back(entry.second.get());
+    }
+    std::sort(result.begin(), result.end(), [](const DeviceTypeInfo* a, const DeviceTypeInfo* b) {
+        return a->name < b->name;
+    });
+    return result;
+}
+
+void DeviceRegistry::loadPlugin(const std::string& path) {
+    void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        throw std::runtime_error("Failed to load plugin " + path + ": " + dlerror());
+    }
+    using RegisterFunction = void (*)(DeviceRegistry&);
+    auto registerTypes = reinterpret_cast<RegisterFunction>(dlsym(handle, "registerDeviceTypes"));
+    if (!registerTypes) {
+        dlclose(handle);
+        throw std::runtime_error("Plugin " + path + " does not export registerDeviceTypes");
+    }
+    registerTypes(*this);
+    pluginHandles.push_back(handle);
+    std::cout << "Loaded device plugin: " << path << "\n";
+}
+
+size_t DeviceRegistry::loadPluginDirectory(const std::string& directory) {
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) {
+        throw std::runtime_error("Cannot open plugin directory: " + directory);
+    }
+
+    std::vector<std::string> paths;
+    while (dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, ".so") == 0) {
+            paths.push_back(directory + "/" + name);
+        }
+    }
+    closedir(dir);
+
+    std::sort(paths.begin(), paths.end());
+    size_t loaded = 0;
+    for (const auto& path : paths) {
+        try {
+            loadPlugin(path);
+            loaded++;
+        } catch (const std::exception& e) {
+            std::cerr << "Warning: " << e.what() << "\n";
+        }
+    }
+    return loaded;
+}
@@ -0,0 +1,243 @@
+#include "../include/DeviceSnapshot.h"
+#include <stdexcept>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const uint32_t SNAPSHOT_MAGIC = 0x44534E31; // "DSN1"
+static const uint32_t SNAPSHOT_VERSION = 1;
+// Changes within this window are written together
+static const auto COALESCE_DELAY = std::chrono::milliseconds(100);
+
+static void putFixed(std::string& out, uint64_t value, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+static bool getFixed(const std::string& in, size_t& pos, size_t size, uint64_t& value) {
+    if (pos + size > in.size()) return false;
+    value = 0;
+    for (size_t i = 0; i < size; ++i) {
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(in[pos + i])) << (8 * i);
+    }
+    pos += size;
+    return true;
+}
+
+static void putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+static bool getVarint(const std::string& in, size_t& pos, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; pos < in.size() && shift < 64; shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(in[pos++]);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+static void putString(std::string& out, const std::string& value) {
+    putVarint(out, value.size());
+    out += value;
+}
+
+static bool getString(const std::string& in, size_t& pos, std::string& value) {
+    uint64_t size;
+    if (!getVarint(in, pos, size) || size > in.size() - pos) return false;
+    value.assign(in, pos, size);
+    pos += size;
+    return true;
+}
+
+// FNV-1a
+static uint32_t checksum(const char* data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ static_cast<uint8_t>(data[i])) * 16777619u;
+    }
+    return hash;
+}
+
+DeviceSnapshot::DeviceSnapshot(const std::string& path, std::chrono::seconds interval)
+    : path(path), interval(interval) {}
+
+DeviceSnapshot::~DeviceSnapshot() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopWriter = true;
+    }
+    writerCondition.notify_all();
+    if (writerThread.joinable()) {
+        writerThread.join();
+    }
+    // Devices may outlive the snapshot; stop them from calling back into it
+    for (auto& entry : entries) {
+        entry.device->removeChangeListener(entry.listenerId);
+    }
+    try {
+        writeNow();
+    } catch (const std::exception& e) {
+        std::cerr << "Warning: " << e.what() << "\n";
+    }
+}
+
+// Layout: magic, version, record count, then per record the type, ID and
+// password as length-prefixed strings and the 8-byte state word; a checksum
+// of everything before it ends the file
+std::string DeviceSnapshot::encode(const std::vector<Record>& records) {
+    std::string out;
+    out.reserve(16 + records.size() * 48);
+    putFixed(out, SNAPSHOT_MAGIC, 4);
+    putFixed(out, SNAPSHOT_VERSION, 4);
+    putVarint(out, records.size());
+    for (const auto& record : records) {
+        putString(out, record.type);
+        putString(out, record.id);
+        putString(out, record.password);
+        putFixed(out, record.state, 8);
+    }
+    putFixed(out, checksum(out.data(), out.size()), 4);
+    return out;
+}
+
+bool DeviceSnapshot::decode(const std::string& bytes, std::vector<Record>& records) {
+    if (bytes.size() < 12) return false;
+    size_t end = bytes.size() - 4;
+    size_t pos = end;
+    uint64_t stored, magic, version, count;
+    if (!getFixed(bytes, pos, 4, stored) || stored != checksum(bytes.data(), end)) return false;
+
+    pos = 0;
+    if (!getFixed(bytes, pos, 4, magic) || magic != SNAPSHOT_MAGIC ||
+        !getFixed(bytes, pos, 4, version) || version != SNAPSHOT_VERSION ||
+        !getVarint(bytes, pos, count)) {
+        return false;
+    }
+    std::string payload = bytes.substr(0, end);
+    records.clear();
+    records.reserve(std::min<uint64_t>(count, payload.size()));
+    for (uint64_t i = 0; i < count; ++i) {
+        Record record;
+        if (!getString(payload, pos, record.type) || !getString(payload, pos, record.id) ||
+            !getString(payload, pos, record.password) || !getFixed(payload, pos, 8, record.state)) {
+            return false;
+        }
+        records.push_back(std::move(record));
+    }
+    return pos == end;
+}
+
+std::unordered_map<std::string, DeviceSnapshot::Record> DeviceSnapshot::load() const {
+    std::unordered_map<std::string, Record> byId;
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) return byId;
+    std::ostringstream contents;
+    contents << in.rdbuf();
+
+    std::vector<Record> records;
+    if (!decode(contents.str(), records)) {
+        std::cerr << "Warning: ignoring unreadable snapshot " << path << "\n";
+        return byId;
+    }
+    byId.reserve(records.size());
+    for (auto& record : records) {
+        std::string id = record.id;
+        byId.emplace(std::move(id), std::move(record));
+    }
+    return byId;
+}
+
+void DeviceSnapshot::track(const std::shared_ptr<Device>& device, CommandHandler& handler, const std::string& password) {
+    uint64_t listenerId = device->addChangeListener([this]() { markDirty(); });
+    size_t index;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        index = entries.size();
+        entries.push_back({device, password, listenerId});
+    }
+    handler.setPasswordListener([this, index](const std::string& newPassword) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            entries[index].password = newPassword;
+        }
+        markDirty();
+    });
+}
+
+void DeviceSnapshot::start() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!writerThread.joinable()) {
+        writerThread = std::thread(&DeviceSnapshot::writerThreadFunction, this);
+    }
+}
+
+void DeviceSnapshot::markDirty() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        dirty = true;
+    }
+    writerCondition.notify_one();
+}
+
+void DeviceSnapshot::writeNow() {
+    std::vector<Record> records;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        dirty = false;
+        records.reserve(entries.size());
+        for (const auto& entry : entries) {
+            records.push_back({entry.device->getType(), entry.device->getId(), entry.password,
+                               entry.device->getState().pack()});
+        }
+    }
+    std::string bytes = encode(records);
+
+    std::string temporary = path + ".tmp";
+    int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open snapshot file: " + temporary);
+    }
+    size_t written = 0;
+    while (written < bytes.size()) {
+        ssize_t n = write(fd, bytes.data() + written, bytes.size() - written);
+        if (n <= 0) {
+            close(fd);
+            throw std::runtime_error("Failed to write snapshot file: " + temporary);
+        }
+        written += static_cast<size_t>(n);
+    }
+    bool synced = fsync(fd) == 0;
+    close(fd);
+    if (!synced || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Failed to replace snapshot file: " + path);
+    }
+}
+
+void DeviceSnapshot::writerThreadFunction() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopWriter) {
+        writerCondition.wait_for(lock, interval, [this] { return stopWriter || dirty; });
+        if (stopWriter) break;
+        if (dirty) {
+            // Let a burst of changes settle into one write
+            writerCondition.wait_for(lock, COALESCE_DELAY, [this] { return stopWriter; });
+        }
+        lock.unlock();
+        try {
+            writeNow();
+        } catch (const std::exception& e) {
+            std::cerr << "Warning: " << e.what() << "\n";
+        }
+        lock.lock();
+    }
+}
@@ -0,0 +1,178 @@
+#include "../include/DeviceTable.h"
+#include <chrono>
+#include <stdexcept>
+
+DeviceTable& DeviceTable::getInstance() {
+    static DeviceTable instance;
+    return instance;
+}
+
+DeviceTable::DeviceTable()
+    : originMs(std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now().time_since_epoch()).count()) {}
+
+int64_t DeviceTable::nowMs() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count() - originMs;
+}
+
+DeviceTable::Slot DeviceTable::allocate() {
+    Slot slot;
+    {
+        std::lock_guard<std::mutex> lock(allocMutex);
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        } else {
+            size_t next = used.load(std::memory_order_relaxed);
+            if (next == kMaxChunks * kChunk) {
+                throw std::runtime_error("Device table is full");
+            }
+            // A new chunk is in place before `used` lets the kernels reach it
+            if (next % kChunk == 0) {
+                chunks[next / kChunk] = std::make_unique<Chunk>();
+            }
+            slot = static_cast<Slot>(next);
+            used.store(next + 1, std::memory_order_release);
+        }
+    }
+    live++;
+    Chunk& chunk = chunkOf(slot);
+    size_t i = slot % kChunk;
+    int64_t now = nowMs();
+    std::lock_guard<std::mutex> lock(chunk.mutex[i / kBlock]);
+    chunk.sessionStartMs[i] = now;
+    return slot;
+}
+
+void DeviceTable::release(Slot slot) {
+    {
+        Chunk& chunk = chunkOf(slot);
+        size_t i = slot % kChunk;
+        std::lock_guard<std::mutex> lock(chunk.mutex[i / kBlock]);
+        chunk.energyOffset[i / kBlock] -= chunk.energyWattMs[i] - static_cast<int64_t>(chunk.power[i]) * chunk.sessionStartMs[i];
+        chunk.on[i] = 0;
+        chunk.speed[i] = 0;
+        chunk.mode[i] = 0;
+        chunk.temperature[i] = 0;
+        chunk.group[i] = 0;
+        chunk.power[i] = 0;
+        chunk.sessionStartMs[i] = 0;
+        chunk.energyWattMs[i] = 0;
+    }
+    live--;
+    std::lock_guard<std::mutex> lock(allocMutex);
+    freeSlots.push_back(slot);
+}
+
+void DeviceTable::update(Slot slot, const DeviceState& state) {
+    Chunk& chunk = chunkOf(slot);
+    size_t i = slot % kChunk;
+    int64_t now = nowMs();
+    std::lock_guard<std::mutex> lock(chunk.mutex[i / kBlock]);
+    int64_t before = chunk.energyWattMs[i] - static_cast<int64_t>(chunk.power[i]) * chunk.sessionStartMs[i];
+    chunk.energyWattMs[i] += static_cast<int64_t>(chunk.power[i]) * (now - chunk.sessionStartMs[i]);
+    chunk.sessionStartMs[i] = now;
+    chunk.on[i] = state.on;
+    chunk.speed[i] = static_cast<uint8_t>(state.speed);
+    chunk.mode[i] = static_cast<uint8_t>(state.mode);
+    chunk.temperature[i] = static_cast<uint8_t>(state.temperature);
+    chunk.power[i] = static_cast<uint16_t>(state.power);
+    chunk.energyOffset[i / kBlock] += chunk.energyWattMs[i] - static_cast<int64_t>(chunk.power[i]) * now - before;
+}
+
+void DeviceTable::setGroup(Slot slot, uint8_t newGroup) {
+    Chunk& chunk = chunkOf(slot);
+    size_t i = slot % kChunk;
+    std::lock_guard<std::mutex> lock(chunk.mutex[i / kBlock]);
+    chunk.group[i] = newGroup;
+}
+
+size_t DeviceTable::size() const {
+    return live.load();
+}
+
+// The kernels visit blocks in order, each under its own lock, so every block
+// is consistent in itself but the result is not one atomic snapshot of the
+// fleet. They sum a block into a narrow accumulator (a block of 64 cannot
+// overflow it) and widen once per block.
+
+size_t DeviceTable::countOn() const {
+    size_t count = 0;
+    for (size_t b = 0, n = blockCount(); b < n; ++b) {
+        Chunk& chunk = *chunks[b / kChunkBlocks];
+        size_t block = b % kChunkBlocks;
+        const uint8_t* column = chunk.on + block * kBlock;
+        std::lock_guard<std::mutex> lock(chunk.mutex[block]);
+        uint32_t blockOn = 0;
+        for (size_t i = 0; i < kBlock; ++i) {
+            blockOn += column[i];
+        }
+        count += blockOn;
+    }
+    return count;
+}
+
+int64_t DeviceTable::totalPower() const {
+    int64_t total = 0;
+    for (size_t b = 0, n = blockCount(); b < n; ++b) {
+        Chunk& chunk = *chunks[b / kChunkBlocks];
+        size_t block = b % kChunkBlocks;
+        const uint16_t* column = chunk.power + block * kBlock;
+        std::lock_guard<std::mutex> lock(chunk.mutex[block]);
+        uint32_t blockTotal = 0;
+        for (size_t i = 0; i < kBlock; ++i) {
+            blockTotal += column[i];
+        }
+        total += blockTotal;
+    }
+    return total;
+}
+
+int64_t DeviceTable::totalEnergyWattMs() const {
+    int64_t now = nowMs();
+    int64_t total = 0;
+    for (size_t b = 0, n = blockCount(); b < n; ++b) {
+        Chunk& chunk = *chunks[b / kChunkBlocks];
+        size_t block = b % kChunkBlocks;
+        const uint16_t* column = chunk.power + block * kBlock;
+        std::lock_guard<std::mutex> lock(chunk.mutex[block]);
+        uint32_t blockTotal = 0;
+        for (size_t i = 0; i < kBlock; ++i) {
+            blockTotal += column[i];
+        }
+        total += chunk.energyOffset[block] + now * blockTotal;
+    }
+    return total;
+}
+
+// Scatter-adds into four interleaved histograms so consecutive slots of the
+// same group do not wait on each other; the 32-bit bins are flushed every
+// 1024 blocks, well before they could overflow
+std::vector<int64_t> DeviceTable::powerByGroup() const {
+    std::vector<int64_t> totals(kMaxGroups, 0);
+    uint32_t bins[4][kMaxGroups] = {};
+    auto flush = [&]() {
+        for (size_t g = 0; g < kMaxGroups; ++g) {
+            totals[g] += static_cast<int64_t>(bins[0][g]) + bins[1][g] + bins[2][g] + bins[3][g];
+            bins[0][g] = bins[1][g] = bins[2][g] = bins[3][g] = 0;
+        }
+    };
+
+    for (size_t b = 0, n = blockCount(); b < n; ++b) {
+        Chunk& chunk = *chunks[b / kChunkBlocks];
+        size_t block = b % kChunkBlocks;
+        const uint16_t* powers = chunk.power + block * kBlock;
+        const uint8_t* groups = chunk.group + block * kBlock;
+        std::lock_guard<std::mutex> lock(chunk.mutex[block]);
+        for (size_t i = 0; i < kBlock; i += 4) {
+            bins[0][groups[i]] += powers[i];
+            bins[1][groups[i + 1]] += powers[i + 1];
+            bins[2][groups[i + 2]] += powers[i + 2];
+            bins[3][groups[i + 3]] += powers[i + 3];
+        }
+        if (b % 1024 == 1023) flush();
+    }
+    flush();
+    return totals;
+}
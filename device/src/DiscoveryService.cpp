@@ -0,0 +1,483 @@
+#include "../include/DiscoveryService.h"
+#include "../lib/json.hpp"
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <poll.h>
+
+using json = nlohmann::json;
+
+static const char BINARY_MAGIC[4] = {'D', 'S', 'C', '2'};
+static const uint8_t FLAG_BYEBYE = 0x01;
+
+DiscoveryService& DiscoveryService::getInstance() {
+    static DiscoveryService instance;
+    return instance;
+}
+
+DiscoveryService::DiscoveryService() {
+    wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+}
+
+DiscoveryService::~DiscoveryService() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopFlag = true;
+    }
+    wake();
+    if (thread.joinable()) {
+        thread.join();
+    }
+    if (wakeFd >= 0) {
+        close(wakeFd);
+    }
+}
+
+void DiscoveryService::wake() {
+    uint64_t one = 1;
+    if (write(wakeFd, &one, sizeof(one)) < 0) {
+        // Already signalled
+    }
+}
+
+void DiscoveryService::setEncoding(Encoding newEncoding) {
+    std::lock_guard<std::mutex> lock(mutex);
+    encoding = newEncoding;
+    changed = true;
+}
+
+void DiscoveryService::announce(const Announcement& announcement) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        devices[announcement.id] = announcement;
+        changed = true;
+        added = true;
+        if (!thread.joinable()) {
+            thread = std::thread(&DiscoveryService::run, this);
+        }
+    }
+    wake();
+}
+
+// withdraw
+// The byebye goes out right away; the remaining devices are re-encoded
+// without starting a new burst.
+void DiscoveryService::withdraw(const std::string& id) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = devices.find(id);
+        if (it == devices.end()) return;
+        departed.push_back(std::move(it->second));
+        devices.erase(it);
+        changed = true;
+    }
+    wake();
+}
+
+// stateChanged
+// Announcements carry no state, so a change only needs the host seen again
+// soon. Further changes before that announcement goes out share it.
+void DiscoveryService::stateChanged() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (refresh || !thread.joinable()) return;
+        refresh = true;
+    }
+    wake();
+}
+
+// --- Encoding ---
+
+static void putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+static bool getVarint(const uint8_t*& pos, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; pos < end && shift < 64; shift += 7) {
+        uint8_t byte = *pos++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+static std::vector<std::string> encodeJson(const std::vector<DiscoveryService::Announcement>& announcements,
+                                           const std::string& ipAddress, int ttl, bool byebye) {
+    std::vector<std::string> datagrams;
+    if (announcements.size() == 1) {
+        const auto& only = announcements.front();
+        json message = {{"type", only.type}, {"id", only.id}, {"ipAddress", ipAddress}, {"port", only.port}, {"ttl", ttl}};
+        if (byebye) message["action"] = "byebye";
+        datagrams.push_back(message.dump());
+        return datagrams;
+    }
+
+    const std::string head = std::string("{") + (byebye ? "\"action\":\"byebye\"," : "") +
+                             "\"ipAddress\":" + json(ipAddress).dump() + ",\"ttl\":" + std::to_string(ttl) + ",\"devices\":[";
+    const std::string tail = "]}";
+    std::string datagram;
+    for (const auto& announcement : announcements) {
+        std::string record = json{{"id", announcement.id}, {"type", announcement.type}, {"port", announcement.port}}.dump();
+        if (!datagram.empty() && datagram.size() + 1 + record.size() + tail.size() > DiscoveryService::MAX_DATAGRAM) {
+            datagrams.push_back(datagram + tail);
+            datagram.clear();
+        }
+        datagram += datagram.empty() ? head : ",";
+        datagram += record;
+    }
+    if (!datagram.empty()) datagrams.push_back(datagram + tail);
+    return datagrams;
+}
+
+static bool encodeBinary(const std::vector<DiscoveryService::Announcement>& announcements,
+                         const std::string& ipAddress, int ttl, bool byebye, std::vector<std::string>& datagrams) {
+    std::vector<std::string> typeNames;
+    std::map<std::string, uint8_t> typeIndex;
+    for (const auto& announcement : announcements) {
+        if (announcement.id.size() > 255 || announcement.type.size() > 255) return false;
+        if (typeIndex.count(announcement.type)) continue;
+        if (typeNames.size() == 255) return false;
+        typeIndex[announcement.type] = static_cast<uint8_t>(typeNames.size());
+        typeNames.push_back(announcement.type);
+    }
+
+    std::string header(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    header.push_back(static_cast<char>(byebye ? FLAG_BYEBYE : 0));
+    uint16_t ttl16 = static_cast<uint16_t>(std::clamp(ttl, 0, static_cast<int>(UINT16_MAX)));
+    header.push_back(static_cast<char>(ttl16 & 0xFF));
+    header.push_back(static_cast<char>(ttl16 >> 8));
+    in_addr address{};
+    inet_pton(AF_INET, ipAddress.c_str(), &address);
+    header.append(reinterpret_cast<const char*>(&address), 4);
+    header.push_back(static_cast<char>(typeNames.size()));
+    for (const auto& name : typeNames) {
+        header.push_back(static_cast<char>(name.size()));
+        header += name;
+    }
+    // Record count, little endian, patched in when the datagram is full
+    size_t countOffset = header.size();
+    header.append(2, '\0');
+
+    std::vector<DiscoveryService::Announcement> sorted(announcements);
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.id < b.id; });
+
+    std::string datagram;
+    uint16_t count = 0;
+    const std::string* previousId = nullptr;
+    int previousPort = 0;
+    auto finish = [&]() {
+        datagram[countOffset] = static_cast<char>(count & 0xFF);
+        datagram[countOffset + 1] = static_cast<char>(count >> 8);
+        datagrams.push_back(datagram);
+        datagram.clear();
+        count = 0;
+        previousId = nullptr;
+        previousPort = 0;
+    };
+
+    std::string record;
+    for (const auto& announcement : sorted) {
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            if (datagram.empty()) datagram = header;
+            size_t shared = 0;
+            if (previousId) {
+                size_t limit = std::min({previousId->size(), announcement.id.size(), size_t(255)});
+                while (shared < limit && (*previousId)[shared] == announcement.id[shared]) shared++;
+            }
+            int64_t delta = static_cast<int64_t>(announcement.port) - previousPort;
+            record.clear();
+            record.push_back(static_cast<char>(typeIndex[announcement.type]));
+            record.push_back(static_cast<char>(shared));
+            record.push_back(static_cast<char>(announcement.id.size() - shared));
+            record.append(announcement.id, shared, std::string::npos);
+            putVarint(record, static_cast<uint64_t>((delta << 1) ^ (delta >> 63)));
+
+            // Start a new datagram and redo the record without the shared prefix
+            if (count > 0 && (datagram.size() + record.size() > DiscoveryService::MAX_DATAGRAM || count == UINT16_MAX)) {
+                finish();
+                continue;
+            }
+            datagram += record;
+            count++;
+            previousId = &announcement.id;
+            previousPort = announcement.port;
+            break;
+        }
+    }
+    if (count > 0) finish();
+    return true;
+}
+
+std::vector<std::string> DiscoveryService::encode(const std::vector<Announcement>& announcements, Encoding encoding,
+                                                  const std::string& ipAddress, int ttl, bool byebye) {
+    std::vector<std::string> datagrams;
+    if (announcements.empty()) return datagrams;
+    if (encoding == Encoding::BINARY && announcements.size() > 1 &&
+        encodeBinary(announcements, ipAddress, ttl, byebye, datagrams)) {
+        return datagrams;
+    }
+    return encodeJson(announcements, ipAddress, ttl, byebye);
+}
+
+static bool decodeBinary(const uint8_t* pos, const uint8_t* end, DiscoveryService::Message& message) {
+    pos += sizeof(BINARY_MAGIC);
+    if (end - pos < 8) return false;
+    message.byebye = (pos[0] & FLAG_BYEBYE) != 0;
+    message.ttl = pos[1] | (pos[2] << 8);
+    pos += 3;
+    char text[INET_ADDRSTRLEN];
+    in_addr address{};
+    std::memcpy(&address, pos, 4);
+    pos += 4;
+    if (!inet_ntop(AF_INET, &address, text, sizeof(text))) return false;
+    message.ipAddress = text;
+    auto& announcements = message.announcements;
+
+    std::vector<std::string> typeNames(*pos++);
+    for (auto& name : typeNames) {
+        if (pos >= end || end - pos - 1 < *pos) return false;
+        name.assign(reinterpret_cast<const char*>(pos + 1), *pos);
+        pos += 1 + *pos;
+    }
+    if (end - pos < 2) return false;
+    uint16_t count = static_cast<uint16_t>(pos[0] | (pos[1] << 8));
+    pos += 2;
+
+    std::string previousId;
+    int previousPort = 0;
+    for (uint16_t i = 0; i < count; ++i) {
+        if (end - pos < 3) return false;
+        uint8_t type = pos[0], shared = pos[1], rest = pos[2];
+        pos += 3;
+        if (type >= typeNames.size() || shared > previousId.size() || end - pos < rest) return false;
+        DiscoveryService::Announcement announcement;
+        announcement.id = previousId.substr(0, shared);
+        announcement.id.append(reinterpret_cast<const char*>(pos), rest);
+        pos += rest;
+        announcement.type = typeNames[type];
+        uint64_t zigzag;
+        if (!getVarint(pos, end, zigzag)) return false;
+        int64_t delta = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+        announcement.port = static_cast<int>(previousPort + delta);
+        previousId = announcement.id;
+        previousPort = announcement.port;
+        announcements.push_back(std::move(announcement));
+    }
+    return pos == end;
+}
+
+bool DiscoveryService::decode(const char* data, size_t size, Message& decoded) {
+    const auto* bytes = reinterpret_cast<const uint8_t*>(data);
+    if (size >= sizeof(BINARY_MAGIC) && std::memcmp(data, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0) {
+        return decodeBinary(bytes, bytes + size, decoded);
+    }
+    try {
+        json message = json::parse(data, data + size);
+        if (!message.is_object() || !message.contains("ipAddress") || !message["ipAddress"].is_string()) return false;
+        decoded.ipAddress = message["ipAddress"];
+        if (message.contains("ttl") && message["ttl"].is_number_integer()) decoded.ttl = message["ttl"];
+        decoded.byebye = message.contains("action") && message["action"] == "byebye";
+        auto& announcements = decoded.announcements;
+        auto add = [&announcements](const json& record) {
+            if (!record.is_object() || !record.contains("id") || !record["id"].is_string() ||
+                !record.contains("type") || !record["type"].is_string() ||
+                !record.contains("port") || !record["port"].is_number_integer()) {
+                return false;
+            }
+            announcements.push_back({record["id"], record["type"], record["port"]});
+            return true;
+        };
+        if (!message.contains("devices")) return add(message);
+        if (!message["devices"].is_array()) return false;
+        for (const auto& record : message["devices"]) {
+            if (!add(record)) return false;
+        }
+        return true;
+    } catch (const json::exception&) {
+        return false;
+    }
+}
+
+// --- Announcer thread ---
+
+// A scanner's search query is {"action": "discover"}; cheap to reject anything else
+static bool isDiscoveryQuery(const char* data, size_t size) {
+    static const char marker[] = "\"discover\"";
+    if (!memmem(data, size, marker, sizeof(marker) - 1)) return false;
+    try {
+        json query = json::parse(data, data + size);
+        return query.value("action", "") == "discover";
+    } catch (const json::exception&) {
+        return false;
+    }
+}
+
+// Announces every registered device and answers search queries on the
+// multicast group. Queries use their own port so devices are not woken by
+// each other's announcements. Answers go to the group after a random delay
+// so many hosts do not all reply at once, and several queries within one
+// delay window share one answer.
+//
+// Beacons follow a burst of burstCount announcements burstSpacingMs apart,
+// then intervals doubling from minIntervalMs to maxIntervalMs. Each carries
+// a ttl of ttlFactor times the time until the next one (at least
+// minIntervalMs, so a lost datagram at the end of a burst is harmless).
+// A state change moves the next beacon up to minIntervalMs after the last
+// one, or right away if that has passed.
+void DiscoveryService::run() {
+    using Clock = std::chrono::steady_clock;
+
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        perror("UDP socket creation failed");
+        return;
+    }
+
+    sockaddr_in multicastAddr{};
+    multicastAddr.sin_family = AF_INET;
+    multicastAddr.sin_port = htons(multicastPort);
+    inet_pton(AF_INET, multicastIP.c_str(), &multicastAddr.sin_addr);
+
+    // Other device processes on the host share the query port
+    int reuse = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in localAddr{};
+    localAddr.sin_family = AF_INET;
+    localAddr.sin_port = htons(queryPort);
+    localAddr.sin_addr.s_addr = htonl(INADDR_ANY);
+    ip_mreq membership{};
+    membership.imr_multiaddr = multicastAddr.sin_addr;
+    membership.imr_interface.s_addr = htonl(INADDR_ANY);
+    bool listening = bind(sock, (sockaddr *)&localAddr, sizeof(localAddr)) == 0 &&
+                     setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) == 0;
+    if (!listening) {
+        perror("Discovery queries unavailable, sending beacons only");
+    }
+
+    auto sendAll = [&](const std::vector<std::string>& datagrams) {
+        for (const auto& datagram : datagrams) {
+            sendto(sock, datagram.data(), datagram.size(), 0,
+                   (sockaddr *)&multicastAddr, sizeof(multicastAddr));
+        }
+    };
+    auto snapshot = [this]() {
+        std::vector<Announcement> current;
+        current.reserve(devices.size());
+        for (const auto& entry : devices) current.push_back(entry.second);
+        return current;
+    };
+
+    std::mt19937 random(std::random_device{}());
+    std::uniform_int_distribution<int> responseDelay(0, maxResponseDelayMs);
+    auto nextBeacon = Clock::now();
+    auto responseDue = Clock::time_point::max();
+    auto lastSent = Clock::now() - std::chrono::milliseconds(minIntervalMs);
+    bool early = false;   // nextBeacon was brought forward by a state change
+    int burstRemaining = 0;
+    int intervalMs = minIntervalMs;
+    int encodedTtl = -1;
+    std::vector<std::string> datagrams;
+    char buffer[2048];
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopFlag) {
+        auto now = Clock::now();
+        if (!departed.empty()) {
+            std::vector<Announcement> leaving;
+            leaving.swap(departed);
+            Encoding byebyeEncoding = encoding;
+            lock.unlock();
+            sendAll(encode(leaving, byebyeEncoding, ipAddress, 0, true));
+            lock.lock();
+            continue;
+        }
+        if (added) {
+            // Re-encode and start a burst once the registrations have settled
+            added = false;
+            early = false;
+            burstRemaining = burstCount;
+            intervalMs = minIntervalMs;
+            nextBeacon = std::min(nextBeacon, now + std::chrono::milliseconds(settleDelayMs));
+        }
+        if (refresh && !early && burstRemaining == 0) {
+            auto due = std::max(now, lastSent + std::chrono::milliseconds(minIntervalMs));
+            if (due < nextBeacon) {
+                nextBeacon = due;
+                early = true;
+            }
+        }
+        if (now >= nextBeacon || now >= responseDue) {
+            // An answer to a query or an early beacon after a state change
+            // doubles as the next beacon, but does not advance the backoff
+            int delayMs;
+            if (now < nextBeacon || early) {
+                delayMs = intervalMs;
+            } else if (burstRemaining > 1) {
+                burstRemaining--;
+                delayMs = burstSpacingMs;
+            } else if (burstRemaining == 1) {
+                burstRemaining = 0;
+                delayMs = intervalMs = minIntervalMs;
+            } else {
+                delayMs = intervalMs = std::min(intervalMs * 2, maxIntervalMs);
+            }
+            int ttl = (ttlFactor * std::max(delayMs, minIntervalMs) + 999) / 1000;
+            if (changed || ttl != encodedTtl) {
+                datagrams = encode(snapshot(), encoding, ipAddress, ttl);
+                encodedTtl = ttl;
+                changed = false;
+            }
+            lock.unlock();
+            sendAll(datagrams);
+            lock.lock();
+            nextBeacon = now + std::chrono::milliseconds(delayMs);
+            responseDue = Clock::time_point::max();
+            lastSent = now;
+            refresh = false;
+            early = false;
+            continue;
+        }
+
+        auto wakeAt = std::min(nextBeacon, responseDue);
+        int timeoutMs = static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(wakeAt - now).count());
+        lock.unlock();
+        pollfd fds[2] = {{wakeFd, POLLIN, 0}, {sock, POLLIN, 0}};
+        int ready = poll(fds, listening ? 2 : 1, timeoutMs);
+        if (ready > 0 && (fds[0].revents & POLLIN)) {
+            uint64_t count;
+            if (read(wakeFd, &count, sizeof(count)) < 0) {
+                // Nothing pending
+            }
+        }
+        if (ready > 0 && listening && (fds[1].revents & POLLIN)) {
+            ssize_t bytesRead = recv(sock, buffer, sizeof(buffer), 0);
+            if (bytesRead > 0 && isDiscoveryQuery(buffer, static_cast<size_t>(bytesRead))) {
+                responseDue = std::min(responseDue, Clock::now() + std::chrono::milliseconds(responseDelay(random)));
+            }
+        }
+        lock.lock();
+    }
+
+    // The process is going away: say goodbye for everything still announced
+    std::vector<Announcement> leaving;
+    leaving.swap(departed);
+    for (auto& announcement : snapshot()) leaving.push_back(std::move(announcement));
+    Encoding byebyeEncoding = encoding;
+    lock.unlock();
+    sendAll(encode(leaving, byebyeEncoding, ipAddress, 0, true));
+
+    close(sock);
+}
@@ -0,0 +1,181 @@
+#include "../include/EnergyHistory.h"
+#include <algorithm>
+
+namespace {
+
+void putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+uint64_t getVarint(const std::string& in, size_t& offset) {
+    uint64_t value = 0;
+    int shift = 0;
+    while (offset < in.size()) {
+        uint8_t byte = static_cast<uint8_t>(in[offset++]);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) break;
+        shift += 7;
+    }
+    return value;
+}
+
+int64_t ceilTo(int64_t value, int64_t period) {
+    int64_t rounded = value / period * period;
+    return rounded < value ? rounded + period : rounded;
+}
+
+} // namespace
+
+EnergyHistory::EnergyHistory(size_t minuteCapacity, int hourRetentionDays, int dayRetentionDays)
+    : samples(std::max<size_t>(1, minuteCapacity)),
+      hours(3600, static_cast<int64_t>(hourRetentionDays) * 86400),
+      days(86400, static_cast<int64_t>(dayRetentionDays) * 86400) {}
+
+// Minutes only ever move forward; time reported for an earlier minute (e.g.
+// after the wall clock was set back) is folded into the newest sample.
+EnergyHistory::Sample& EnergyHistory::sampleFor(uint32_t minute) {
+    if (count > 0) {
+        Sample& last = samples[(head + count - 1) % samples.size()];
+        if (minute <= last.minute) return last;
+    }
+    if (count == samples.size()) {
+        minuteCoverageStart = (static_cast<int64_t>(samples[head].minute) + 1) * 60;
+        head = (head + 1) % samples.size();
+        count--;
+    }
+    Sample& sample = samples[(head + count) % samples.size()];
+    sample = Sample{minute, 0, 0};
+    count++;
+    return sample;
+}
+
+void EnergyHistory::add(int64_t fromMs, int64_t toMs, int power) {
+    while (fromMs < toMs) {
+        int64_t minuteEnd = (fromMs / 60000 + 1) * 60000;
+        int64_t chunkEnd = std::min(minuteEnd, toMs);
+        Sample& sample = sampleFor(static_cast<uint32_t>(fromMs / 60000));
+
+        uint32_t runtimeMs = static_cast<uint32_t>(chunkEnd - fromMs);
+        int64_t wattMs = wattMsRemainder + power * (chunkEnd - fromMs);
+        uint32_t wattSeconds = static_cast<uint32_t>(wattMs / 1000);
+        wattMsRemainder = wattMs % 1000;
+
+        sample.runtimeMs += runtimeMs;
+        sample.wattSeconds += wattSeconds;
+        int64_t seconds = static_cast<int64_t>(sample.minute) * 60;
+        hours.accumulate(seconds, runtimeMs, wattSeconds);
+        days.accumulate(seconds, runtimeMs, wattSeconds);
+        fromMs = chunkEnd;
+    }
+}
+
+// Rolls the open period up into the compressed series once time moves past it
+void EnergyHistory::Tier::accumulate(int64_t seconds, uint32_t runtimeMs, uint32_t wattSeconds) {
+    int64_t start = seconds / period * period;
+    if (start > open.start) {
+        if (open.runtimeMs > 0) append(open);
+        open = Point{start, period, 0, 0};
+    }
+    open.runtimeMs += runtimeMs;
+    open.wattSeconds += wattSeconds;
+}
+
+void EnergyHistory::Tier::append(const Point& point) {
+    if (blocks.empty() || blocks.back().count >= BLOCK_RECORDS) {
+        blocks.emplace_back();
+        blocks.back().firstStart = point.start;
+        blocks.back().lastStart = point.start;
+    }
+    Block& block = blocks.back();
+    putVarint(block.bytes, static_cast<uint64_t>((point.start - block.lastStart) / period));
+    putVarint(block.bytes, (point.runtimeMs + 500) / 1000);
+    putVarint(block.bytes, point.wattSeconds);
+    block.lastStart = point.start;
+    if (++block.count == BLOCK_RECORDS) {
+        block.bytes.shrink_to_fit();
+    }
+
+    while (blocks.size() > 1 && blocks.front().lastStart < point.start - retention) {
+        coverageStart = blocks.front().lastStart + period;
+        blocks.pop_front();
+    }
+}
+
+void EnergyHistory::Tier::collect(int64_t fromSeconds, int64_t toSeconds, std::vector<Point>& out) const {
+    for (const Block& block : blocks) {
+        if (block.lastStart + period <= fromSeconds) continue;
+        if (block.firstStart > toSeconds) break;
+
+        size_t offset = 0;
+        int64_t start = block.firstStart;
+        for (uint16_t i = 0; i < block.count; ++i) {
+            start += static_cast<int64_t>(getVarint(block.bytes, offset)) * period;
+            uint64_t runtimeSeconds = getVarint(block.bytes, offset);
+            uint64_t wattSeconds = getVarint(block.bytes, offset);
+            if (start + period > fromSeconds && start <= toSeconds) {
+                out.push_back(Point{start, period, runtimeSeconds * 1000, wattSeconds});
+            }
+        }
+    }
+    if (open.runtimeMs > 0 && open.start + period > fromSeconds && open.start <= toSeconds) {
+        out.push_back(open);
+    }
+}
+
+void EnergyHistory::collectMinutes(int64_t fromSeconds, int64_t toSeconds, std::vector<Point>& out) const {
+    // Samples are ordered by minute, so binary search for the first one in range
+    int64_t firstMinute = fromSeconds / 60;
+    size_t low = 0, high = count;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (at(middle).minute < firstMinute) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    for (size_t i = low; i < count && static_cast<int64_t>(at(i).minute) * 60 <= toSeconds; ++i) {
+        const Sample& sample = at(i);
+        out.push_back(Point{static_cast<int64_t>(sample.minute) * 60, 60, sample.runtimeMs, sample.wattSeconds});
+    }
+}
+
+std::vector<EnergyHistory::Point> EnergyHistory::query(int64_t fromSeconds, int64_t toSeconds, int64_t resolution) const {
+    std::vector<Point> result;
+    if (fromSeconds > toSeconds) return result;
+
+    // Tier 0 is the minute ring. Walk from the chosen tier towards coarser
+    // ones, newest part first; each finer tier is used from the first
+    // coarser-period boundary it fully covers so no period is counted twice.
+    int tier = resolution >= 86400 ? 2 : (resolution >= 3600 ? 1 : 0);
+    int64_t end = toSeconds;
+    std::vector<std::vector<Point>> parts;
+    while (true) {
+        int64_t coverage = tier == 0 ? minuteCoverageStart : (tier == 1 ? hours.coverageStart : days.coverageStart);
+        int64_t start = fromSeconds;
+        if (tier < 2 && coverage > fromSeconds) {
+            start = ceilTo(coverage, tier == 0 ? 3600 : 86400);
+        }
+
+        parts.emplace_back();
+        if (start <= end) {
+            if (tier == 0) {
+                collectMinutes(start, end, parts.back());
+            } else {
+                (tier == 1 ? hours : days).collect(start, end, parts.back());
+            }
+        }
+        if (start <= fromSeconds) break;
+        end = start - 1;
+        tier++;
+    }
+
+    for (auto it = parts.rbegin(); it != parts.rend(); ++it) {
+        result.insert(result.end(), it->begin(), it->end());
+    }
+    return result;
+}
@@ -2,33 +2,22 @@
 #include <stdexcept>
 
 Fan::Fan(const std::string& id, const std::string& password)
-    : Device(id, password) {}
-
-void Fan::turnOn() {
-    if (state) throw std::runtime_error("Fan is already on.");
-    state = true;
-    if (speed == 0) speed = 1;
-    powerConsumption = 20 * speed;
-    runtimeTracker.startTimer(powerConsumption);
+    : Device(id, password) {
+    setPowerModel(std::make_shared<FanPowerModel>());
 }
 
-void Fan::turnOff() {
-    if (!state) throw std::runtime_error("Fan is already off.");
-    state = false;
-    powerConsumption = 0;
-    runtimeTracker.stopTimer();
+void Fan::prepareTurnOn(DeviceState& state) const {
+    if (state.speed == 0) state.speed = 1;
 }
 
 void Fan::setSpeed(int newSpeed) {
     if (newSpeed < 0 || newSpeed > 3) throw std::runtime_error("Invalid speed level.");
-    speed = newSpeed;
-    if (state) {
-        runtimeTracker.stopTimer();
-        powerConsumption = 20 * speed;
-        runtimeTracker.startTimer(powerConsumption);
-    }
+    transition([newSpeed](DeviceState state) {
+        state.speed = newSpeed;
+        return state;
+    });
 }
 
 int Fan::getSpeed() const {
-    return speed;
+    return getState().speed;
 }
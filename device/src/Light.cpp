@@ -1,19 +1,6 @@
 #include "../include/Light.h"
-#include <stdexcept>
 
 Light::Light(const std::string& id, const std::string& password)
-    : Device(id, password) {}
-
-void Light::turnOn() {
-    if (state) throw std::runtime_error("Light is already on.");
-    state = true;
-    powerConsumption = 10;
-    runtimeTracker.startTimer(powerConsumption);
-}
-
-void Light::turnOff() {
-    if (!state) throw std::runtime_error("Light is already off.");
-    state = false;
-    powerConsumption = 0;
-    runtimeTracker.stopTimer();
+    : Device(id, password) {
+    setPowerModel(std::make_shared<ConstantPowerModel>(10));
 }
@@ -0,0 +1,137 @@
+#include "../include/LogSink.h"
+#include <functional>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <iostream>
+#include <cctype>
+
+std::string LogSink::sharedBasePath = "log/devices";
+size_t LogSink::sharedShardCount = 1;
+
+LogSink::LogSink(const std::string &basePath, size_t shardCount, size_t bufferLimit)
+    : bufferLimit(bufferLimit) {
+    if (shardCount == 0) shardCount = 1;
+    for (size_t i = 0; i < shardCount; ++i) {
+        std::string path = shardCount == 1 ? basePath + ".log"
+                                           : basePath + "." + std::to_string(i) + ".log";
+        auto shard = std::make_unique<Shard>();
+        shard->stream.open(path, std::ios::app);
+        if (!shard->stream.is_open()) {
+            throw std::runtime_error("Failed to open log file: " + path);
+        }
+        shards.push_back(std::move(shard));
+    }
+    flushThread = std::thread(&LogSink::flushThreadFunction, this);
+}
+
+LogSink::~LogSink() {
+    {
+        std::lock_guard<std::mutex> lock(flushMutex);
+        stopFlush = true;
+    }
+    flushCondition.notify_all();
+    if (flushThread.joinable()) {
+        flushThread.join();
+    }
+    flush();
+}
+
+std::shared_ptr<LogSink> LogSink::getShared() {
+    static std::shared_ptr<LogSink> instance = std::make_shared<LogSink>(sharedBasePath, sharedShardCount);
+    return instance;
+}
+
+void LogSink::configureShared(const std::string &basePath, size_t shardCount) {
+    sharedBasePath = basePath;
+    sharedShardCount = shardCount;
+}
+
+// Lines are appended to an in-memory buffer; the shard is written out when the
+// buffer fills, on urgent (error) lines, or by the once-per-second flusher.
+void LogSink::write(const std::string &deviceId, const std::string &line, bool urgent) {
+    Shard &shard = *shards[std::hash<std::string>{}(deviceId) % shards.size()];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.buffer += line;
+    shard.buffer += '\n';
+    if (urgent || shard.buffer.size() >= bufferLimit) {
+        flushShard(shard);
+    }
+}
+
+void LogSink::flush() {
+    for (auto &shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        flushShard(*shard);
+    }
+}
+
+// Caller must hold shard.mutex
+void LogSink::flushShard(Shard &shard) {
+    if (shard.buffer.empty()) return;
+    shard.stream.write(shard.buffer.data(), shard.buffer.size());
+    shard.stream.flush();
+    shard.buffer.clear();
+}
+
+void LogSink::flushThreadFunction() {
+    std::unique_lock<std::mutex> lock(flushMutex);
+    while (!stopFlush) {
+        flushCondition.wait_for(lock, std::chrono::seconds(1), [this] { return stopFlush; });
+        lock.unlock();
+        flush();
+        lock.lock();
+    }
+}
+
+// Device IDs come from the log contents and become part of a file name, so
+// only letters, digits, '-', '_' and '.' are allowed, and no leading '.'
+static bool isSafeDeviceId(const std::string &deviceId) {
+    if (deviceId.empty() || deviceId[0] == '.') return false;
+    for (char c : deviceId) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_' && c != '.') return false;
+    }
+    return true;
+}
+
+size_t LogSink::demultiplex(const std::string &logFile, const std::string &outputDir) {
+    std::ifstream in(logFile);
+    if (!in.is_open()) {
+        throw std::runtime_error("Failed to open log file: " + logFile);
+    }
+
+    std::unordered_map<std::string, std::ofstream> outputs;
+    std::unordered_set<std::string> rejected;
+    std::string line;
+    size_t written = 0;
+    while (std::getline(in, line)) {
+        // Format: [timestamp] [LEVEL] [deviceId] message
+        size_t pos = 0;
+        for (int field = 0; field < 2 && pos != std::string::npos; ++field) {
+            pos = line.find("] [", pos);
+            if (pos != std::string::npos) pos += 3;
+        }
+        if (pos == std::string::npos) continue;
+        size_t end = line.find(']', pos);
+        if (end == std::string::npos) continue;
+
+        std::string deviceId = line.substr(pos, end - pos);
+        if (!isSafeDeviceId(deviceId)) {
+            if (rejected.insert(deviceId).second) {
+                std::cerr << "Warning: skipping lines of unsafe device ID: " << deviceId << "\n";
+            }
+            continue;
+        }
+        auto it = outputs.find(deviceId);
+        if (it == outputs.end()) {
+            std::string path = outputDir + "/device_" + deviceId + ".log";
+            it = outputs.emplace(deviceId, std::ofstream(path, std::ios::app)).first;
+            if (!it->second.is_open()) {
+                throw std::runtime_error("Failed to open output file: " + path);
+            }
+        }
+        it->second << line << '\n';
+        ++written;
+    }
+    return written;
+}
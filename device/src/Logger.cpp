@@ -2,23 +2,21 @@
 #include <ctime>
 #include <iostream>
 #include <iomanip>
+#include <sstream>
+#include <stdexcept>
 
-Logger::Logger(const std::string &logFile) {
-    logStream.open(logFile, std::ios::app);
-    if (!logStream.is_open()) {
-        throw std::runtime_error("Failed to open log file: " + logFile);
+Logger::Logger(std::shared_ptr<LogSink> sink)
+    : sink(std::move(sink)) {
+    if (!this->sink) {
+        throw std::runtime_error("Logger requires a log sink");
     }
 }
 
-Logger::~Logger() {
-    if (logStream.is_open()) {
-        logStream.close();
-    }
-}
+Logger::~Logger() {}
 
 void Logger::logEvent(const std::string &deviceId, const std::string &message, LogLevel level) {
-    std::lock_guard<std::mutex> lock(logMutex);
-    logStream << formatLog(deviceId, message, level) << std::endl;
+    if (!isLevelEnabled(level)) return;
+    sink->write(deviceId, formatLog(deviceId, message, level), level == ERROR);
 }
 
 void Logger::logError(const std::string &deviceId, const std::string &message) {
@@ -37,10 +35,23 @@ void Logger::logDebug(const std::string &deviceId, const std::string &message) {
     logEvent(deviceId, message, DEBUG);
 }
 
+void Logger::setLevelEnabled(LogLevel level, bool enabled) {
+    if (enabled) {
+        enabledLevels.fetch_or(1u << level);
+    } else {
+        enabledLevels.fetch_and(~(1u << level));
+    }
+}
+
+bool Logger::isLevelEnabled(LogLevel level) const {
+    return (enabledLevels.load(std::memory_order_relaxed) >> level) & 1u;
+}
+
 std::string Logger::formatLog(const std::string &deviceId, const std::string &message, LogLevel level) {
     std::ostringstream logLine;
     auto now = std::time(nullptr);
-    auto tm = *std::localtime(&now);
+    std::tm tm{};
+    localtime_r(&now, &tm);
 
     logLine << "[" << std::put_time(&tm, "%Y-%m-%d %H:%M:%S") << "] ";
     logLine << "[" << logLevelToString(level) << "] ";
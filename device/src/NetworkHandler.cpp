@@ -1,5 +1,7 @@
 #include "../include/NetworkHandler.h"
 #include "../include/Utility.h"
+#include "../include/TimerService.h"
+#include "../include/DiscoveryService.h"
 #include <iostream>
 #include <thread>
 #include <chrono>
@@ -22,44 +24,23 @@ NetworkHandler::~NetworkHandler() {
 void NetworkHandler::start() {
     stopFlag = false;
 
-    // Start discovery thread
-    std::thread(&NetworkHandler::udpDiscovery, this).detach();
+    // Announced by the process-wide discovery service, together with any
+    // other devices hosted here
+    DiscoveryService::getInstance().announce({commandHandler.getDevice()->getId(),
+                                              commandHandler.getDevice()->getType(), tcpPort});
+    changeListenerId = commandHandler.getDevice()->addChangeListener(
+        []() { DiscoveryService::getInstance().stateChanged(); });
 
     // Start TCP server thread
     std::thread(&NetworkHandler::tcpServer, this).detach();
 }
 
 void NetworkHandler::stop() {
-    stopFlag = true;
-}
-
-void NetworkHandler::udpDiscovery() {
-    int sock = socket(AF_INET, SOCK_DGRAM, 0);
-    if (sock < 0) {
-        perror("UDP socket creation failed");
-        return;
+    if (!stopFlag) {
+        commandHandler.getDevice()->removeChangeListener(changeListenerId);
+        DiscoveryService::getInstance().withdraw(commandHandler.getDevice()->getId());
     }
-
-    sockaddr_in multicastAddr{};
-    multicastAddr.sin_family = AF_INET;
-    multicastAddr.sin_port = htons(multicastPort);
-    inet_pton(AF_INET, multicastIP.c_str(), &multicastAddr.sin_addr);
-
-    json messageJson = {
-        {"type", commandHandler.getDevice()->getType()},
-        {"id", commandHandler.getDevice()->getId()},
-        {"ipAddress", "127.0.0.1"},
-        {"port", tcpPort} // Port the device is listening on
-    };
-    std::string message = messageJson.dump();
-
-    while (!stopFlag) {
-        sendto(sock, message.c_str(), message.size(), 0,
-               (sockaddr *)&multicastAddr, sizeof(multicastAddr));
-        std::this_thread::sleep_for(std::chrono::seconds(5));
-    }
-
-    close(sock);
+    stopFlag = true;
 }
 
 void NetworkHandler::tcpServer() {
@@ -71,6 +52,13 @@ void NetworkHandler::tcpServer() {
     FD_SET(serverSock, &masterSet);
     int maxFd = serverSock;
 
+    // Inline timer mode: due timers are dispatched on this thread
+    int timerFd = TimerService::getInstance().getEventFd();
+    if (timerFd >= 0) {
+        FD_SET(timerFd, &masterSet);
+        if (timerFd > maxFd) maxFd = timerFd;
+    }
+
     while (!stopFlag) {
         readSet = masterSet;
         int activity = select(maxFd + 1, &readSet, nullptr, nullptr, nullptr);
@@ -83,8 +71,12 @@ void NetworkHandler::tcpServer() {
             handleNewConnection(serverSock, masterSet, maxFd);
         }
 
+        if (timerFd >= 0 && FD_ISSET(timerFd, &readSet)) {
+            TimerService::getInstance().dispatchDue();
+        }
+
         for (int sock = 0; sock <= maxFd; ++sock) {
-            if (sock != serverSock && FD_ISSET(sock, &readSet)) {
+            if (sock != serverSock && sock != timerFd && FD_ISSET(sock, &readSet)) {
                 if (!handleClientRequest(sock)) {
                     closeClientConnection(sock, masterSet);
                 }
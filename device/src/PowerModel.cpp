@@ -0,0 +1,36 @@
+#include "../include/PowerModel.h"
+#include <algorithm>
+
+std::atomic<double> PowerModel::ambient{28.0};
+
+double PowerModel::getAmbient() {
+    return ambient.load(std::memory_order_relaxed);
+}
+
+void PowerModel::setAmbient(double celsius) {
+    ambient.store(celsius, std::memory_order_relaxed);
+}
+
+int ConstantPowerModel::powerFor(const DeviceState& state, double) const {
+    return state.on ? onWatts : standbyWatts;
+}
+
+int FanPowerModel::powerFor(const DeviceState& state, double) const {
+    if (!state.on) return parameters.standbyWatts;
+    double fraction = std::min(1.0, static_cast<double>(state.speed) / parameters.maxSpeed);
+    return parameters.lossWatts + static_cast<int>(parameters.ratedWatts * fraction * fraction * fraction + 0.5);
+}
+
+int ACPowerModel::powerFor(const DeviceState& state, double ambient) const {
+    if (!state.on) return parameters.standbyWatts;
+
+    // Mode values follow ACMode: COOL, HEAT, DRY
+    double duty;
+    if (state.mode == 2) {
+        duty = parameters.dryDuty;
+    } else {
+        double delta = state.mode == 0 ? ambient - state.temperature : state.temperature - ambient;
+        duty = delta <= 0 ? 0.0 : std::min(1.0, parameters.minDuty + parameters.dutyPerDegree * delta);
+    }
+    return parameters.fanWatts + static_cast<int>(parameters.compressorWatts * duty + 0.5);
+}
@@ -0,0 +1,87 @@
+#include "../include/RuntimeStateFile.h"
+#include <stdexcept>
+#include <cstddef>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const uint32_t STATE_MAGIC = 0x52545331; // "RTS1"
+static const uint32_t STATE_VERSION = 2; // Files of any other version start over
+
+RuntimeStateFile::RuntimeStateFile(const std::string& path) {
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open runtime state file: " + path);
+    }
+
+    struct stat info{};
+    if (fstat(fd, &info) != 0 ||
+        (info.st_size < static_cast<off_t>(sizeof(Layout)) && ftruncate(fd, sizeof(Layout)) != 0)) {
+        close(fd);
+        throw std::runtime_error("Failed to size runtime state file: " + path);
+    }
+
+    void* mapped = mmap(nullptr, sizeof(Layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("Failed to map runtime state file: " + path);
+    }
+    layout = static_cast<Layout*>(mapped);
+
+    if (layout->magic != STATE_MAGIC || layout->version != STATE_VERSION) {
+        *layout = Layout{};
+        layout->magic = STATE_MAGIC;
+        layout->version = STATE_VERSION;
+    }
+    const Slot* newest = newestSlot();
+    sequence = newest ? newest->sequence : 0;
+}
+
+RuntimeStateFile::~RuntimeStateFile() {
+    if (layout) {
+        msync(layout, sizeof(Layout), MS_SYNC);
+        munmap(layout, sizeof(Layout));
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+// FNV-1a over everything but the checksum itself
+uint32_t RuntimeStateFile::checksum(const Slot& slot) {
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&slot);
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(Slot, checksum); ++i) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+const RuntimeStateFile::Slot* RuntimeStateFile::newestSlot() const {
+    const Slot* newest = nullptr;
+    for (const Slot& slot : layout->slots) {
+        if (slot.sequence == 0 || slot.checksum != checksum(slot)) continue;
+        if (!newest || slot.sequence > newest->sequence) newest = &slot;
+    }
+    return newest;
+}
+
+bool RuntimeStateFile::load(Counters& counters) const {
+    const Slot* newest = newestSlot();
+    if (!newest) return false;
+    counters = newest->counters;
+    return true;
+}
+
+// Overwrites the older slot. The page cache keeps the write across a process
+// crash; MS_ASYNC starts writing it back without blocking the caller.
+void RuntimeStateFile::store(const Counters& counters) {
+    sequence++;
+    Slot& slot = layout->slots[sequence % 2];
+    slot.sequence = sequence;
+    slot.counters = counters;
+    slot.reserved = 0;
+    slot.checksum = checksum(slot);
+    msync(layout, sizeof(Layout), MS_ASYNC);
+}
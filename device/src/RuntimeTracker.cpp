@@ -1,84 +1,264 @@
 #include "../include/RuntimeTracker.h"
 #include <chrono>
-#include <iostream>
 #include <ctime>
+#include <algorithm>
 
 using namespace std;
 
+static int64_t epochMs(chrono::system_clock::time_point time) {
+    return chrono::duration_cast<chrono::milliseconds>(time.time_since_epoch()).count();
+}
+
+namespace {
+
+class SystemClock : public RuntimeTracker::Clock {
+public:
+    chrono::steady_clock::time_point steadyNow() const override {
+        return chrono::steady_clock::now();
+    }
+    int64_t wallNowMs() const override {
+        return epochMs(chrono::system_clock::now());
+    }
+};
+
+} // namespace
+
 // Constructor
-RuntimeTracker::RuntimeTracker() {
-    lastUpdate = std::time(nullptr); // Initialize the last update time to now
+RuntimeTracker::RuntimeTracker(std::shared_ptr<const Clock> clock)
+    : clock(clock ? std::move(clock) : std::make_shared<SystemClock>()) {
+    lastUpdate = static_cast<std::time_t>(this->clock->wallNowMs() / 1000); // Initialize the last update time to now
+    accountedSince = this->clock->steadyNow();
+    setBoundariesLocked(lastUpdate);
 }
 
 // Destructor
 RuntimeTracker::~RuntimeTracker() {}
 
-// Reset daily, monthly, and yearly runtimes if a new period has started
-void RuntimeTracker::resetIfNewPeriod() {
-    std::time_t now = std::time(nullptr);
-    std::tm *currentTime = std::localtime(&now);
-    std::tm *lastTime = std::localtime(&lastUpdate);
+// Local-time calendar periods the runtime is reset at
+enum Period { DAY, MONTH, YEAR };
 
-    // Reset daily runtime if the day has changed
-    if (currentTime->tm_yday != lastTime->tm_yday) {
-        dailyRuntime = 0;
+// Start of the local day, month or year containing `time`
+static std::time_t periodStart(std::time_t time, Period period) {
+    std::tm local{};
+    localtime_r(&time, &local);
+    local.tm_hour = 0;
+    local.tm_min = 0;
+    local.tm_sec = 0;
+    if (period >= MONTH) local.tm_mday = 1;
+    if (period == YEAR) local.tm_mon = 0;
+    local.tm_isdst = -1; // Let mktime pick the DST offset of that moment
+    return std::mktime(&local);
+}
+
+// Start of the period following the one containing `time`
+static std::time_t nextPeriodStart(std::time_t time, Period period) {
+    std::tm local{};
+    localtime_r(&time, &local);
+    local.tm_hour = 0;
+    local.tm_min = 0;
+    local.tm_sec = 0;
+    if (period == DAY) {
+        local.tm_mday++;
+    } else if (period == MONTH) {
+        local.tm_mday = 1;
+        local.tm_mon++;
+    } else {
+        local.tm_mday = 1;
+        local.tm_mon = 0;
+        local.tm_year++;
     }
+    local.tm_isdst = -1;
+    return std::mktime(&local);
+}
+
+// Caches when the current day, month and year end. Caller must hold mutex.
+void RuntimeTracker::setBoundariesLocked(std::time_t now) {
+    nextDayStart = nextPeriodStart(now, DAY);
+    nextMonthStart = nextPeriodStart(now, MONTH);
+    nextYearStart = nextPeriodStart(now, YEAR);
+}
 
-    // Reset monthly runtime if the month has changed
-    if (currentTime->tm_mon != lastTime->tm_mon) {
-        monthlyRuntime = 0;
+// Adds the energy drawn since the last call and, while on, the session's
+// time to the counters and the history. A session is split at each day,
+// month and year boundary it crosses; when none is crossed this costs one
+// compare. Caller must hold mutex.
+void RuntimeTracker::accountLocked() {
+    auto steadyNow = clock->steadyNow();
+    int64_t wallNowMs = clock->wallNowMs();
+
+    int64_t elapsed = std::max<int64_t>(0, chrono::duration_cast<chrono::milliseconds>(steadyNow - accountedSince).count());
+    cumulativeWattMs += elapsed * currentPower;
+
+    int64_t remaining = running ? elapsed : 0;
+    // Durations come from the steady clock; the wall clock only places them
+    int64_t segmentStartMs = wallNowMs - remaining;
+    if (remaining > 0) {
+        history.add(segmentStartMs, wallNowMs, currentPower);
     }
+    totalRuntimeMs += remaining;
+
+    while (wallNowMs >= static_cast<int64_t>(nextDayStart) * 1000) {
+        int64_t before = std::min(remaining, std::max<int64_t>(0, static_cast<int64_t>(nextDayStart) * 1000 - segmentStartMs));
+        dailyRuntimeMs += before;
+        monthlyRuntimeMs += before;
+        yearlyRuntimeMs += before;
+        remaining -= before;
+        segmentStartMs += before;
 
-    // Reset yearly runtime if the year has changed
-    if (currentTime->tm_year != lastTime->tm_year) {
-        yearlyRuntime = 0;
+        // A month or year boundary is always also a day boundary
+        std::time_t boundary = nextDayStart;
+        dailyRuntimeMs = 0;
+        if (boundary >= nextMonthStart) monthlyRuntimeMs = 0;
+        if (boundary >= nextYearStart) yearlyRuntimeMs = 0;
+        setBoundariesLocked(boundary);
     }
+    dailyRuntimeMs += remaining;
+    monthlyRuntimeMs += remaining;
+    yearlyRuntimeMs += remaining;
 
-    lastUpdate = now; // Update the last update time
+    accountedSince = steadyNow;
+    lastUpdate = static_cast<std::time_t>(wallNowMs / 1000);
 }
 
-// Start the timer for runtime tracking
-void RuntimeTracker::startTimer(int power) {
-    lastStartTime = chrono::system_clock::now();
+// Close the previous piece of the power curve and start the next one
+void RuntimeTracker::setState(bool on, int power) {
+    std::lock_guard<std::mutex> lock(mutex);
+    accountLocked();
+    running = on;
     currentPower = power;
-    cout << "Timer started with power: " << power << "W\n"; // Debug output
+    if (!on) checkpointLocked();
+    publishLocked();
 }
 
-// Stop the timer and update runtime and power consumption
-void RuntimeTracker::stopTimer() {
-    auto now = chrono::system_clock::now();
-    auto duration = chrono::duration_cast<chrono::seconds>(now - lastStartTime).count();
+// Update runtime dynamically
+void RuntimeTracker::updateRuntime() {
+    std::lock_guard<std::mutex> lock(mutex);
+    accountLocked(); // Ensure runtime is accurate for the current period
+    checkpointLocked();
+    publishLocked();
+}
+
+bool RuntimeTracker::attachStateFile(const std::string& path) {
+    auto file = std::make_unique<RuntimeStateFile>(path);
+    std::lock_guard<std::mutex> lock(mutex);
+    RuntimeStateFile::Counters counters;
+    bool restored = file->load(counters);
+    if (restored) {
+        totalRuntimeMs = counters.totalRuntimeMs;
+        dailyRuntimeMs = counters.dailyRuntimeMs;
+        monthlyRuntimeMs = counters.monthlyRuntimeMs;
+        yearlyRuntimeMs = counters.yearlyRuntimeMs;
+        cumulativeWattMs = counters.cumulativeWattMs;
+        lastUpdate = static_cast<std::time_t>(counters.lastUpdate);
+        // Reset the periods that ended while the device was down
+        setBoundariesLocked(lastUpdate);
+        accountLocked();
+    }
+    stateFile = std::move(file);
+    publishLocked();
+    return restored;
+}
+
+// Caller must hold mutex
+void RuntimeTracker::checkpointLocked() {
+    if (!stateFile) return;
+    RuntimeStateFile::Counters counters;
+    counters.totalRuntimeMs = totalRuntimeMs;
+    counters.dailyRuntimeMs = dailyRuntimeMs;
+    counters.monthlyRuntimeMs = monthlyRuntimeMs;
+    counters.yearlyRuntimeMs = yearlyRuntimeMs;
+    counters.cumulativeWattMs = cumulativeWattMs;
+    counters.lastUpdate = lastUpdate;
+    stateFile->store(counters);
+}
 
-    resetIfNewPeriod(); // Check if a new period has started
+// Caller must hold mutex, which also keeps writers from interleaving
+void RuntimeTracker::publishLocked() {
+    uint64_t sequence = published.sequence.load(std::memory_order_relaxed);
+    published.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
 
-    totalRuntime += duration;
-    dailyRuntime += duration;
-    monthlyRuntime += duration;
-    yearlyRuntime += duration;
-    cumulativePowerConsumption += duration * currentPower;
+    published.totalRuntimeMs.store(totalRuntimeMs, std::memory_order_relaxed);
+    published.dailyRuntimeMs.store(dailyRuntimeMs, std::memory_order_relaxed);
+    published.monthlyRuntimeMs.store(monthlyRuntimeMs, std::memory_order_relaxed);
+    published.yearlyRuntimeMs.store(yearlyRuntimeMs, std::memory_order_relaxed);
+    published.cumulativeWattMs.store(cumulativeWattMs, std::memory_order_relaxed);
+    published.accountedSinceNs.store(accountedSince.time_since_epoch().count(), std::memory_order_relaxed);
+    published.sessionOn.store(running, std::memory_order_relaxed);
+    published.sessionPower.store(currentPower, std::memory_order_relaxed);
+    published.nextDayStart.store(nextDayStart, std::memory_order_relaxed);
+    published.nextMonthStart.store(nextMonthStart, std::memory_order_relaxed);
+    published.nextYearStart.store(nextYearStart, std::memory_order_relaxed);
 
-    currentPower = 0; // Reset power
-    cout << "Timer stopped. Duration: " << duration << " seconds\n"; // Debug output
+    published.sequence.store(sequence + 2, std::memory_order_release);
 }
 
-// Update runtime dynamically
-void RuntimeTracker::updateRuntime() {
-    resetIfNewPeriod(); // Ensure runtime is accurate for the current period
+RuntimeTracker::Totals RuntimeTracker::getTotals() const {
+    Totals totals;
+    int64_t accountedSinceNs, nextDay, nextMonth, nextYear;
+    bool sessionOn;
+    int sessionPower;
+    uint64_t before, after;
+    do {
+        before = published.sequence.load(std::memory_order_acquire);
+        totals.totalRuntimeMs = published.totalRuntimeMs.load(std::memory_order_relaxed);
+        totals.dailyRuntimeMs = published.dailyRuntimeMs.load(std::memory_order_relaxed);
+        totals.monthlyRuntimeMs = published.monthlyRuntimeMs.load(std::memory_order_relaxed);
+        totals.yearlyRuntimeMs = published.yearlyRuntimeMs.load(std::memory_order_relaxed);
+        totals.cumulativeWattMs = published.cumulativeWattMs.load(std::memory_order_relaxed);
+        accountedSinceNs = published.accountedSinceNs.load(std::memory_order_relaxed);
+        sessionOn = published.sessionOn.load(std::memory_order_relaxed);
+        sessionPower = published.sessionPower.load(std::memory_order_relaxed);
+        nextDay = published.nextDayStart.load(std::memory_order_relaxed);
+        nextMonth = published.nextMonthStart.load(std::memory_order_relaxed);
+        nextYear = published.nextYearStart.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = published.sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+
+    // Add the current draw and the running session lazily from where the
+    // counters left off
+    auto since = chrono::steady_clock::time_point(chrono::steady_clock::duration(accountedSinceNs));
+    int64_t elapsedMs = std::max<int64_t>(0, chrono::duration_cast<chrono::milliseconds>(clock->steadyNow() - since).count());
+    totals.cumulativeWattMs += elapsedMs * sessionPower;
+    int64_t sessionMs = sessionOn ? elapsedMs : 0;
+    totals.totalRuntimeMs += sessionMs;
+
+    // Past a period boundary the counted total belongs to the previous
+    // period; only the part of a running session after the start of the
+    // current period counts. This slow path is rare
+    std::time_t now = static_cast<std::time_t>(clock->wallNowMs() / 1000);
+    auto periodTotal = [&](int64_t counted, int64_t nextStart, Period period) {
+        if (now < nextStart) return counted + sessionMs;
+        int64_t sincePeriodStart = (static_cast<int64_t>(now) - periodStart(now, period)) * 1000;
+        return std::min(sessionMs, sincePeriodStart);
+    };
+    totals.dailyRuntimeMs = periodTotal(totals.dailyRuntimeMs, nextDay, DAY);
+    totals.monthlyRuntimeMs = periodTotal(totals.monthlyRuntimeMs, nextMonth, MONTH);
+    totals.yearlyRuntimeMs = periodTotal(totals.yearlyRuntimeMs, nextYear, YEAR);
+    return totals;
 }
 
 // Accessors
-int RuntimeTracker::getDailyRuntime() const {
-    return dailyRuntime;
+int64_t RuntimeTracker::getDailyRuntime() const {
+    return getTotals().dailyRuntimeMs / 1000;
+}
+
+int64_t RuntimeTracker::getMonthlyRuntime() const {
+    return getTotals().monthlyRuntimeMs / 1000;
 }
 
-int RuntimeTracker::getMonthlyRuntime() const {
-    return monthlyRuntime;
+int64_t RuntimeTracker::getYearlyRuntime() const {
+    return getTotals().yearlyRuntimeMs / 1000;
 }
 
-int RuntimeTracker::getYearlyRuntime() const {
-    return yearlyRuntime;
+int64_t RuntimeTracker::getCumulativePowerConsumption() const {
+    return getTotals().cumulativeWattMs / 1000;
 }
 
-int RuntimeTracker::getCumulativePowerConsumption() const {
-    return cumulativePowerConsumption;
+std::vector<EnergyHistory::Point> RuntimeTracker::getHistory(int64_t fromSeconds, int64_t toSeconds, int64_t resolution) {
+    std::lock_guard<std::mutex> lock(mutex);
+    accountLocked();
+    publishLocked();
+    return history.query(fromSeconds, toSeconds, resolution);
 }
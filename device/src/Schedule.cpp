@@ -0,0 +1,243 @@
+#include "../include/Schedule.h"
+#include <sstream>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+
+namespace {
+
+// Lowest set bit of `mask` in [from, limit), or -1
+int nextBit(uint64_t mask, int from, int limit) {
+    if (from >= limit) return -1;
+    uint64_t candidates = mask & (~0ULL << from);
+    if (candidates == 0) return -1;
+    int bit = __builtin_ctzll(candidates);
+    return bit < limit ? bit : -1;
+}
+
+int parseNumber(const std::string& text, const std::string& field) {
+    if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos) {
+        throw std::invalid_argument("Invalid cron field: " + field);
+    }
+    return std::stoi(text);
+}
+
+// Parses one cron field into a bit mask over [minValue, maxValue]
+uint64_t parseField(const std::string& field, int minValue, int maxValue) {
+    uint64_t mask = 0;
+    std::stringstream items(field);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        int step = 1;
+        size_t slash = item.find('/');
+        if (slash != std::string::npos) {
+            step = parseNumber(item.substr(slash + 1), field);
+            item = item.substr(0, slash);
+            if (step <= 0) throw std::invalid_argument("Invalid cron step: " + field);
+        }
+
+        int first = minValue, last = maxValue;
+        if (item != "*") {
+            size_t dash = item.find('-');
+            if (dash != std::string::npos) {
+                first = parseNumber(item.substr(0, dash), field);
+                last = parseNumber(item.substr(dash + 1), field);
+            } else {
+                first = parseNumber(item, field);
+                last = slash != std::string::npos ? maxValue : first;
+            }
+        }
+        if (first < minValue || last > maxValue || first > last) {
+            throw std::invalid_argument("Cron field out of range: " + field);
+        }
+        for (int value = first; value <= last; value += step) {
+            mask |= 1ULL << value;
+        }
+    }
+    if (mask == 0) throw std::invalid_argument("Empty cron field: " + field);
+    return mask;
+}
+
+std::chrono::steady_clock::time_point toSteady(std::time_t wallTime) {
+    auto wallNow = std::chrono::system_clock::now();
+    auto steadyNow = std::chrono::steady_clock::now();
+    return steadyNow + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::system_clock::from_time_t(wallTime) - wallNow);
+}
+
+std::time_t toWall(std::chrono::steady_clock::time_point steadyTime) {
+    auto wallNow = std::chrono::system_clock::now();
+    auto steadyNow = std::chrono::steady_clock::now();
+    return std::chrono::system_clock::to_time_t(
+        wallNow + std::chrono::duration_cast<std::chrono::system_clock::duration>(steadyTime - steadyNow));
+}
+
+} // namespace
+
+CronExpression CronExpression::parse(const std::string& expression) {
+    std::istringstream input(expression);
+    std::vector<std::string> fields;
+    std::string field;
+    while (input >> field) fields.push_back(field);
+    if (fields.size() != 5) {
+        throw std::invalid_argument("Cron expression needs 5 fields: " + expression);
+    }
+
+    CronExpression cron;
+    cron.minutes = parseField(fields[0], 0, 59);
+    cron.hours = static_cast<uint32_t>(parseField(fields[1], 0, 23));
+    cron.days = static_cast<uint32_t>(parseField(fields[2], 1, 31));
+    cron.months = static_cast<uint32_t>(parseField(fields[3], 1, 12) >> 1); // tm_mon is 0-based
+    uint64_t weekdays = parseField(fields[4], 0, 7);
+    if (weekdays & (1ULL << 7)) weekdays |= 1; // 7 is also Sunday
+    cron.weekdays = static_cast<uint32_t>(weekdays & 0x7F);
+    cron.daysRestricted = fields[2][0] != '*';
+    cron.weekdaysRestricted = fields[4][0] != '*';
+    cron.expression = fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3] + " " + fields[4];
+    return cron;
+}
+
+// Standard cron rule: when both day fields are restricted either may match
+bool CronExpression::dayMatches(const std::tm& time) const {
+    bool dayOfMonth = (days >> time.tm_mday) & 1;
+    bool dayOfWeek = (weekdays >> time.tm_wday) & 1;
+    if (daysRestricted && weekdaysRestricted) return dayOfMonth || dayOfWeek;
+    return dayOfMonth && dayOfWeek;
+}
+
+std::time_t CronExpression::next(std::time_t after) const {
+    std::time_t start = after - after % 60 + 60;
+    std::tm time{};
+    localtime_r(&start, &time);
+    time.tm_sec = 0;
+
+    // Let mktime carry overflowing fields and resolve DST
+    auto normalize = [&time]() {
+        time.tm_isdst = -1;
+        std::time_t value = std::mktime(&time);
+        localtime_r(&value, &time);
+        return value;
+    };
+
+    // Each iteration advances at least one field, so this bounds the search
+    // to roughly five years of candidate days.
+    for (int guard = 0; guard < 4000; ++guard) {
+        if (!((months >> time.tm_mon) & 1)) {
+            int month = nextBit(months, time.tm_mon + 1, 12);
+            if (month < 0) {
+                time.tm_year++;
+                month = nextBit(months, 0, 12);
+            }
+            time.tm_mon = month;
+            time.tm_mday = 1;
+            time.tm_hour = 0;
+            time.tm_min = 0;
+            normalize();
+            continue;
+        }
+
+        int hour = dayMatches(time) ? nextBit(hours, time.tm_hour, 24) : -1;
+        if (hour < 0) {
+            time.tm_mday++;
+            time.tm_hour = 0;
+            time.tm_min = 0;
+            normalize();
+            continue;
+        }
+        if (hour != time.tm_hour) {
+            time.tm_hour = hour;
+            time.tm_min = 0;
+        }
+
+        int minute = nextBit(minutes, time.tm_min, 60);
+        if (minute < 0) {
+            time.tm_hour++;
+            time.tm_min = 0;
+            normalize();
+            continue;
+        }
+        time.tm_min = minute;
+
+        // A DST gap may shift the candidate; accept it only if it still matches
+        std::time_t candidate = normalize();
+        if (time.tm_hour == hour && time.tm_min == minute && candidate > after) {
+            return candidate;
+        }
+        if (candidate <= after) {
+            // Ambiguous local time at the end of DST: try the later occurrence
+            std::time_t later = candidate + 3600;
+            localtime_r(&later, &time);
+            if (later > after && time.tm_hour == hour && time.tm_min == minute) {
+                return later;
+            }
+            time.tm_sec = 0;
+        }
+    }
+    return -1;
+}
+
+TimerSchedule TimerSchedule::every(int seconds) {
+    if (seconds <= 0) throw std::invalid_argument("Schedule interval must be positive");
+    TimerSchedule schedule;
+    schedule.kind = Kind::INTERVAL;
+    schedule.intervalSeconds = seconds;
+    return schedule;
+}
+
+TimerSchedule TimerSchedule::calendar(const std::string& expression) {
+    TimerSchedule schedule;
+    schedule.kind = Kind::CRON;
+    schedule.cron = CronExpression::parse(expression);
+    if (schedule.cron.next(std::time(nullptr)) < 0) {
+        throw std::invalid_argument("Cron expression never fires: " + expression);
+    }
+    return schedule;
+}
+
+std::chrono::steady_clock::time_point TimerSchedule::firstDeadline(std::chrono::steady_clock::time_point now) const {
+    switch (kind) {
+        case Kind::INTERVAL:
+            return now + std::chrono::seconds(intervalSeconds);
+        case Kind::CRON:
+            return toSteady(cron.next(toWall(now)));
+        default:
+            return now;
+    }
+}
+
+std::chrono::steady_clock::time_point TimerSchedule::nextDeadline(std::chrono::steady_clock::time_point previous,
+                                                                  std::chrono::steady_clock::time_point now) const {
+    switch (kind) {
+        case Kind::INTERVAL: {
+            // Stay on the original grid so firing latency does not accumulate
+            auto interval = std::chrono::seconds(intervalSeconds);
+            auto next = previous + interval;
+            if (next <= now) {
+                next += interval * ((now - next) / interval + 1);
+            }
+            return next;
+        }
+        case Kind::CRON: {
+            // Round the previous occurrence to its minute so a slightly early
+            // wake-up cannot match the same minute twice
+            std::time_t previousWall = toWall(previous);
+            previousWall = (previousWall + 30) / 60 * 60;
+            std::time_t after = std::max(previousWall, toWall(now));
+            std::time_t next = cron.next(after);
+            return next < 0 ? std::chrono::steady_clock::time_point::max() : toSteady(next);
+        }
+        default:
+            return now;
+    }
+}
+
+std::string TimerSchedule::describe() const {
+    switch (kind) {
+        case Kind::INTERVAL:
+            return "every " + std::to_string(intervalSeconds) + "s";
+        case Kind::CRON:
+            return "cron " + cron.toString();
+        default:
+            return "once";
+    }
+}
@@ -0,0 +1,185 @@
+#include "../include/TimerJournal.h"
+#include <unordered_map>
+#include <stdexcept>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+TimerJournal::TimerJournal(const std::string& path)
+    : path(path) {
+    openForAppend();
+}
+
+TimerJournal::~TimerJournal() {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+void TimerJournal::openForAppend() {
+    fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open timer journal: " + path);
+    }
+}
+
+std::vector<TimerJournal::Entry> TimerJournal::load() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::string data;
+    int readFd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (readFd >= 0) {
+        struct stat info{};
+        if (fstat(readFd, &info) == 0 && info.st_size > 0) {
+            data.resize(static_cast<size_t>(info.st_size));
+            size_t offset = 0;
+            while (offset < data.size()) {
+                ssize_t n = read(readFd, &data[offset], data.size() - offset);
+                if (n <= 0) break;
+                offset += static_cast<size_t>(n);
+            }
+            data.resize(offset);
+        }
+        close(readFd);
+    }
+
+    // First pass only tracks where each live timer's latest record starts,
+    // so superseded records are never decoded.
+    std::unordered_map<uint64_t, size_t> live;
+    live.reserve(data.size() / sizeof(RecordHeader));
+    size_t offset = 0;
+    recordCount = 0;
+    while (offset + sizeof(RecordHeader) <= data.size()) {
+        RecordHeader header;
+        std::memcpy(&header, data.data() + offset, sizeof(header));
+        size_t textLength = header.actionLength;
+        if (header.kind == static_cast<uint8_t>(TimerSchedule::Kind::CRON)) textLength += header.param;
+        if (offset + sizeof(header) + textLength > data.size()) break; // Torn tail
+
+        if (header.op == CLEAR) {
+            live.clear();
+        } else if (header.op == REMOVE) {
+            live.erase(header.id);
+        } else if (header.op == ADD) {
+            live[header.id] = offset;
+        }
+        offset += sizeof(header) + textLength;
+        recordCount++;
+    }
+
+    std::vector<Entry> result;
+    result.reserve(live.size());
+    for (const auto& item : live) {
+        RecordHeader header;
+        std::memcpy(&header, data.data() + item.second, sizeof(header));
+        const char* text = data.data() + item.second + sizeof(header);
+
+        Entry entry{header.id, header.deadlineMs, std::string(text, header.actionLength), TimerSchedule{}};
+        try {
+            if (header.kind == static_cast<uint8_t>(TimerSchedule::Kind::INTERVAL)) {
+                entry.schedule = TimerSchedule::every(static_cast<int>(header.param));
+            } else if (header.kind == static_cast<uint8_t>(TimerSchedule::Kind::CRON)) {
+                entry.schedule = TimerSchedule::calendar(std::string(text + header.actionLength, header.param));
+            }
+        } catch (const std::exception&) {
+            continue; // Schedule no longer valid; drop the timer
+        }
+        result.push_back(std::move(entry));
+    }
+    return result;
+}
+
+void TimerJournal::appendRecord(std::string& buffer, uint8_t op, const Entry& entry) {
+    RecordHeader header{};
+    header.op = op;
+    header.kind = static_cast<uint8_t>(entry.schedule.kind);
+    header.actionLength = static_cast<uint16_t>(entry.action.size());
+    header.id = entry.id;
+    header.deadlineMs = entry.deadlineMs;
+
+    std::string cron;
+    if (entry.schedule.kind == TimerSchedule::Kind::INTERVAL) {
+        header.param = static_cast<uint32_t>(entry.schedule.intervalSeconds);
+    } else if (entry.schedule.kind == TimerSchedule::Kind::CRON) {
+        cron = entry.schedule.cron.toString();
+        header.param = static_cast<uint32_t>(cron.size());
+    }
+
+    buffer.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    buffer.append(entry.action, 0, header.actionLength);
+    buffer += cron;
+}
+
+// One write() per record keeps appends from concurrent writers whole. Records
+// reach the page cache immediately, so they survive a process crash.
+void TimerJournal::writeLocked(const std::string& buffer) {
+    size_t offset = 0;
+    while (offset < buffer.size()) {
+        ssize_t n = write(fd, buffer.data() + offset, buffer.size() - offset);
+        if (n <= 0) {
+            perror("Failed to write timer journal");
+            return;
+        }
+        offset += static_cast<size_t>(n);
+    }
+    recordCount++;
+}
+
+void TimerJournal::recordAdd(const Entry& entry) {
+    std::string buffer;
+    appendRecord(buffer, ADD, entry);
+    std::lock_guard<std::mutex> lock(mutex);
+    writeLocked(buffer);
+}
+
+void TimerJournal::recordRemove(uint64_t id) {
+    std::string buffer;
+    appendRecord(buffer, REMOVE, Entry{id, 0, "", TimerSchedule{}});
+    std::lock_guard<std::mutex> lock(mutex);
+    writeLocked(buffer);
+}
+
+void TimerJournal::recordClear() {
+    std::string buffer;
+    appendRecord(buffer, CLEAR, Entry{0, 0, "", TimerSchedule{}});
+    std::lock_guard<std::mutex> lock(mutex);
+    writeLocked(buffer);
+}
+
+bool TimerJournal::needsCompaction(size_t liveCount) const {
+    return recordCount > 2 * liveCount + 64;
+}
+
+void TimerJournal::compact(const std::vector<Entry>& live) {
+    std::string buffer;
+    buffer.reserve(live.size() * (sizeof(RecordHeader) + 8));
+    for (const auto& entry : live) {
+        appendRecord(buffer, ADD, entry);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::string tempPath = path + ".tmp";
+    int tempFd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (tempFd < 0) {
+        perror("Failed to create compacted timer journal");
+        return;
+    }
+    size_t offset = 0;
+    while (offset < buffer.size()) {
+        ssize_t n = write(tempFd, buffer.data() + offset, buffer.size() - offset);
+        if (n <= 0) break;
+        offset += static_cast<size_t>(n);
+    }
+    bool complete = offset == buffer.size() && fsync(tempFd) == 0;
+    close(tempFd);
+    if (!complete || rename(tempPath.c_str(), path.c_str()) != 0) {
+        perror("Failed to replace timer journal");
+        unlink(tempPath.c_str());
+        return;
+    }
+
+    close(fd);
+    openForAppend();
+    recordCount = live.size();
+}
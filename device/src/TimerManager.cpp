@@ -2,77 +2,177 @@
 #include <iostream>
 #include <chrono>
 
-TimerManager::TimerManager() {
-    timerThread = std::thread(&TimerManager::timerThreadFunction, this);
+using Clock = TimerService::Clock;
+
+// Journal deadlines are wall-clock milliseconds so they stay meaningful
+// across restarts; the scheduler itself runs on the steady clock.
+static int64_t toEpochMs(Clock::time_point deadline) {
+    auto wall = std::chrono::system_clock::now() +
+                std::chrono::duration_cast<std::chrono::system_clock::duration>(deadline - Clock::now());
+    return std::chrono::duration_cast<std::chrono::milliseconds>(wall.time_since_epoch()).count();
+}
+
+TimerManager::TimerManager(TimerService& service)
+    : service(service), owner(service.registerOwner()) {
+    service.setCallback(owner, [this](const TimerInfo& timer) { onTimerFired(timer); });
 }
 
 TimerManager::~TimerManager() {
+    detach();
+}
+
+uint64_t TimerManager::setTimer(int duration, const std::string& action) {
+    auto deadline = Clock::now() + std::chrono::seconds(duration);
+    uint64_t id;
     {
-        std::lock_guard<std::mutex> lock(timerMutex);
-        stopThread = true;
-        timerCondition.notify_all();
-    }
-    if (timerThread.joinable()) {
-        // join để đảm bảo thread đã kết thúc trước khi hủy đối tượng TimerManager
-        timerThread.join();
+        std::lock_guard<std::mutex> lock(mutex);
+        id = service.schedule(owner, deadline, action);
+        journalAddLocked(id, deadline, action, TimerSchedule{});
     }
+    std::cout << "Timer " << id << " set for " << duration << " seconds to execute: " << action << "\n";
+    return id;
 }
 
-void TimerManager::setTimer(int duration, const std::string& action) {
+uint64_t TimerManager::setSchedule(const TimerSchedule& schedule, const std::string& action) {
+    auto deadline = schedule.firstDeadline(Clock::now());
+    uint64_t id;
     {
-        std::lock_guard<std::mutex> lock(timerMutex);
-        timerQueue.push({duration, action});
+        std::lock_guard<std::mutex> lock(mutex);
+        id = service.schedule(owner, deadline, action, std::make_shared<const TimerSchedule>(schedule));
+        journalAddLocked(id, deadline, action, schedule);
     }
-    timerCondition.notify_all();
-    std::cout << "Timer set for " << duration << " seconds to execute: " << action << "\n";
+    std::cout << "Timer " << id << " scheduled " << schedule.describe() << " to execute: " << action << "\n";
+    return id;
+}
+
+bool TimerManager::cancelTimer(uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    bool canceled = service.cancel(owner, id);
+    if (canceled) {
+        if (journal) {
+            journal->recordRemove(id);
+            if (journaledTimers > 0) journaledTimers--;
+            compactJournalLocked();
+        }
+        std::cout << "Timer " << id << " canceled.\n";
+    }
+    return canceled;
 }
 
 void TimerManager::cancelAllTimers() {
     {
-        std::lock_guard<std::mutex> lock(timerMutex);
-        cancelCurrentTimer = true;
-        while (!timerQueue.empty()) {
-            timerQueue.pop();
+        std::lock_guard<std::mutex> lock(mutex);
+        service.cancelAll(owner);
+        if (journal) {
+            journal->recordClear();
+            journaledTimers = 0;
         }
     }
-    timerCondition.notify_all();
     std::cout << "All timers canceled.\n";
 }
 
+std::vector<TimerInfo> TimerManager::listTimers() {
+    return service.list(owner);
+}
+
 void TimerManager::registerCallback(const std::function<void(const std::string&)>& callback) {
+    std::lock_guard<std::mutex> lock(mutex);
     actionCallback = callback;
 }
 
-void TimerManager::timerThreadFunction() {
-    while (true) {
-        TimerRequest request;
-        {
-            // Tạo phạm vi riêng để quản lý mutex
-            std::unique_lock<std::mutex> lock(timerMutex);
-
-            // Đợi cho đến khi:
-            // - Có tác vụ trong hàng đợi `timerQueue`, hoặc
-            // - Có tín hiệu dừng `stopThread` được đặt thành true
-            timerCondition.wait(lock, [this] { 
-                return !timerQueue.empty() || stopThread; 
-            });
-
-            // Nếu tín hiệu dừng (`stopThread`) được kích hoạt và không còn tác vụ nào, thoát khỏi vòng lặp
-            if (stopThread && timerQueue.empty()) 
-                break;
-
-            // Lấy tác vụ từ hàng đợi `timerQueue`
-            request = timerQueue.front();
-            timerQueue.pop();
-        } // Mở khóa mutex ở đây để các thread khác có thể truy cập `timerQueue`
-
-        // Tiến hành đợi cho đến khi tác vụ được hoàn thành (thời gian `duration` giây)
-        std::this_thread::sleep_for(std::chrono::seconds(request.duration));
-
-        // Sau khi hết thời gian, nếu không có lệnh hủy timer (`cancelCurrentTimer`)
-        // và callback được đăng ký (`actionCallback`), thực hiện hành động được yêu cầu
-        if (!cancelCurrentTimer && actionCallback) {
-            actionCallback(request.action);
+size_t TimerManager::enablePersistence(const std::string& path, TimerCatchUp catchUp) {
+    std::lock_guard<std::mutex> lock(mutex);
+    journal = std::make_unique<TimerJournal>(path);
+    std::vector<TimerJournal::Entry> entries = journal->load();
+
+    auto nowSteady = Clock::now();
+    int64_t nowMs = toEpochMs(nowSteady);
+
+    std::vector<TimerRequest> requests;
+    std::vector<TimerJournal::Entry> restored;
+    requests.reserve(entries.size());
+    restored.reserve(entries.size());
+    for (auto& entry : entries) {
+        auto deadline = nowSteady + std::chrono::milliseconds(entry.deadlineMs - nowMs);
+        if (deadline <= nowSteady) {
+            if (catchUp == TimerCatchUp::FIRE) {
+                deadline = nowSteady;
+            } else if (entry.schedule.isRecurring()) {
+                deadline = entry.schedule.nextDeadline(deadline, nowSteady);
+                if (deadline == Clock::time_point::max()) continue;
+            } else {
+                continue;
+            }
+        }
+
+        std::shared_ptr<const TimerSchedule> recurrence;
+        if (entry.schedule.isRecurring()) {
+            recurrence = std::make_shared<const TimerSchedule>(entry.schedule);
         }
+        requests.push_back({deadline, entry.action, std::move(recurrence)});
+        entry.deadlineMs = nowMs + std::chrono::duration_cast<std::chrono::milliseconds>(deadline - nowSteady).count();
+        restored.push_back(std::move(entry));
+    }
+
+    // Restored timers get fresh IDs; rewrite the journal to match them
+    std::vector<uint64_t> ids = service.scheduleBatch(owner, std::move(requests));
+    for (size_t i = 0; i < ids.size(); ++i) {
+        restored[i].id = ids[i];
+    }
+    journal->compact(restored);
+    journaledTimers = restored.size();
+
+    std::cout << "Restored " << restored.size() << " of " << entries.size() << " persisted timers.\n";
+    return restored.size();
+}
+
+void TimerManager::detach() {
+    service.unregisterOwner(owner);
+}
+
+void TimerManager::onTimerFired(const TimerInfo& timer) {
+    std::function<void(const std::string&)> callback;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (journal) {
+            if (timer.recurrence) {
+                // Record the next occurrence so a restart resumes the schedule,
+                // unless the timer was cancelled while this callback was queued
+                if (service.isPending(owner, timer.id)) {
+                    journal->recordAdd({timer.id, toEpochMs(timer.deadline), timer.action, *timer.recurrence});
+                    compactJournalLocked();
+                }
+            } else {
+                journal->recordRemove(timer.id);
+                if (journaledTimers > 0) journaledTimers--;
+                compactJournalLocked();
+            }
+        }
+        callback = actionCallback;
+    }
+    if (callback) {
+        callback(timer.action);
+    }
+}
+
+void TimerManager::journalAddLocked(uint64_t id, Clock::time_point deadline, const std::string& action,
+                                    const TimerSchedule& schedule) {
+    if (!journal || id == 0) return;
+    journal->recordAdd({id, toEpochMs(deadline), action, schedule});
+    journaledTimers++;
+    compactJournalLocked();
+}
+
+void TimerManager::compactJournalLocked() {
+    if (!journal || !journal->needsCompaction(journaledTimers)) return;
+
+    std::vector<TimerInfo> timers = service.list(owner);
+    std::vector<TimerJournal::Entry> live;
+    live.reserve(timers.size());
+    for (const auto& timer : timers) {
+        live.push_back({timer.id, toEpochMs(timer.deadline), timer.action,
+                        timer.recurrence ? *timer.recurrence : TimerSchedule{}});
     }
+    journal->compact(live);
+    journaledTimers = live.size();
 }
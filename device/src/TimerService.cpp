@@ -0,0 +1,323 @@
+#include "../include/TimerService.h"
+#include <algorithm>
+#include <stdexcept>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+size_t TimerService::configuredThreads = 1;
+
+// Owner whose callback is running on the current dispatch thread, used so a
+// callback may unregister its own owner without waiting on itself.
+static thread_local TimerService::OwnerId currentOwner = 0;
+
+TimerService::TimerService(size_t dispatchThreads)
+    : dispatchThreads(dispatchThreads) {
+    if (dispatchThreads == 0) {
+        timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (timerFd < 0) {
+            throw std::runtime_error("Failed to create timerfd");
+        }
+    }
+}
+
+TimerService::~TimerService() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+    for (auto& thread : threads) {
+        if (thread.joinable()) thread.join();
+    }
+    if (timerFd >= 0) {
+        close(timerFd);
+    }
+}
+
+TimerService& TimerService::getInstance() {
+    static TimerService instance(configuredThreads);
+    return instance;
+}
+
+void TimerService::configure(size_t dispatchThreads) {
+    configuredThreads = dispatchThreads;
+}
+
+TimerService::OwnerId TimerService::registerOwner() {
+    std::lock_guard<std::mutex> lock(mutex);
+    OwnerId owner = nextOwner++;
+    owners.emplace(owner, OwnerState{});
+    return owner;
+}
+
+void TimerService::unregisterOwner(OwnerId owner) {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = owners.find(owner);
+    if (it == owners.end()) return;
+
+    cancelAllLocked(it->second);
+
+    int self = currentOwner == owner ? 1 : 0;
+    idleCondition.wait(lock, [&] {
+        auto current = owners.find(owner);
+        return current == owners.end() || current->second.running <= self;
+    });
+    owners.erase(owner);
+    compactLocked();
+}
+
+void TimerService::setCallback(OwnerId owner, const Callback& callback) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = owners.find(owner);
+    if (it != owners.end()) {
+        it->second.callback = callback;
+    }
+}
+
+TimerService::TimerId TimerService::schedule(OwnerId owner, Clock::time_point deadline, const std::string& action,
+                                             std::shared_ptr<const TimerSchedule> recurrence) {
+    TimerId id;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = owners.find(owner);
+        if (it == owners.end()) return 0;
+
+        id = nextTimer++;
+        timers.emplace(id, TimerRecord{owner, deadline, action, std::move(recurrence)});
+        it->second.timers.insert(id);
+        heap.push_back({deadline, id});
+        std::push_heap(heap.begin(), heap.end(), EntryLater());
+        startThreadsLocked();
+    }
+    // Wake dispatchers in case the new timer is now the earliest
+    wakeCondition.notify_all();
+    return id;
+}
+
+std::vector<TimerService::TimerId> TimerService::scheduleBatch(OwnerId owner, std::vector<TimerRequest> requests) {
+    std::vector<TimerId> ids;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = owners.find(owner);
+        if (it == owners.end()) return ids;
+
+        ids.reserve(requests.size());
+        timers.reserve(timers.size() + requests.size());
+        it->second.timers.reserve(it->second.timers.size() + requests.size());
+        heap.reserve(heap.size() + requests.size());
+        for (auto& request : requests) {
+            TimerId id = nextTimer++;
+            heap.push_back({request.deadline, id});
+            timers.emplace(id, TimerRecord{owner, request.deadline, std::move(request.action), std::move(request.recurrence)});
+            it->second.timers.insert(id);
+            ids.push_back(id);
+        }
+        std::make_heap(heap.begin(), heap.end(), EntryLater());
+        if (!ids.empty()) startThreadsLocked();
+    }
+    wakeCondition.notify_all();
+    return ids;
+}
+
+bool TimerService::cancel(OwnerId owner, TimerId id) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = timers.find(id);
+        if (it == timers.end() || it->second.owner != owner) return false;
+
+        owners[owner].timers.erase(id);
+        timers.erase(it);
+        staleEntries++;
+        compactLocked();
+        armLocked();
+    }
+    wakeCondition.notify_all();
+    return true;
+}
+
+void TimerService::cancelAll(OwnerId owner) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = owners.find(owner);
+        if (it == owners.end()) return;
+
+        cancelAllLocked(it->second);
+        compactLocked();
+        armLocked();
+    }
+    wakeCondition.notify_all();
+}
+
+bool TimerService::isPending(OwnerId owner, TimerId id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = timers.find(id);
+    return it != timers.end() && it->second.owner == owner;
+}
+
+std::vector<TimerInfo> TimerService::list(OwnerId owner) {
+    std::vector<TimerInfo> result;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = owners.find(owner);
+        if (it == owners.end()) return result;
+
+        result.reserve(it->second.timers.size());
+        for (TimerId id : it->second.timers) {
+            const TimerRecord& record = timers.at(id);
+            result.push_back({id, record.deadline, record.action, record.recurrence});
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const TimerInfo& a, const TimerInfo& b) {
+        return a.deadline != b.deadline ? a.deadline < b.deadline : a.id < b.id;
+    });
+    return result;
+}
+
+void TimerService::cancelAllLocked(OwnerState& state) {
+    for (TimerId id : state.timers) {
+        timers.erase(id);
+    }
+    staleEntries += state.timers.size();
+    state.timers.clear();
+}
+
+// Also re-arms the timerfd in inline mode, where no threads are started
+void TimerService::startThreadsLocked() {
+    armLocked();
+    if (!threads.empty()) return;
+    for (size_t i = 0; i < dispatchThreads; ++i) {
+        threads.emplace_back(&TimerService::dispatchThreadFunction, this);
+    }
+}
+
+// Rebuild the heap without stale entries once they make up more than half of it
+void TimerService::compactLocked() {
+    if (staleEntries < 1024 || staleEntries * 2 < heap.size()) return;
+
+    heap.erase(std::remove_if(heap.begin(), heap.end(), [this](const Entry& entry) {
+        return timers.find(entry.id) == timers.end();
+    }), heap.end());
+    std::make_heap(heap.begin(), heap.end(), EntryLater());
+    staleEntries = 0;
+}
+
+// Pops the earliest timer if it is due. Live timers are marked running and
+// returned with their callback; stale entries are discarded.
+bool TimerService::takeDueLocked(Clock::time_point now, Dispatch& dispatch) {
+    while (!heap.empty() && heap.front().deadline <= now) {
+        std::pop_heap(heap.begin(), heap.end(), EntryLater());
+        TimerId id = heap.back().id;
+        heap.pop_back();
+
+        auto it = timers.find(id);
+        if (it == timers.end()) {
+            if (staleEntries > 0) staleEntries--;
+            continue;
+        }
+
+        OwnerId owner = it->second.owner;
+        OwnerState& state = owners[owner];
+
+        // Recurring timers are re-armed under the same ID before the action
+        // runs, so they stay listed and can be cancelled at any time.
+        Clock::time_point next = Clock::time_point::max();
+        if (it->second.recurrence) {
+            next = it->second.recurrence->nextDeadline(it->second.deadline, now);
+        }
+        dispatch.timer = TimerInfo{id, next, it->second.action, it->second.recurrence};
+        if (next != Clock::time_point::max()) {
+            it->second.deadline = next;
+            heap.push_back({next, id});
+            std::push_heap(heap.begin(), heap.end(), EntryLater());
+        } else {
+            dispatch.timer.recurrence = nullptr;
+            dispatch.timer.deadline = it->second.deadline;
+            timers.erase(it);
+            state.timers.erase(id);
+        }
+        state.running++;
+        dispatch.owner = owner;
+        dispatch.callback = state.callback;
+        return true;
+    }
+    return false;
+}
+
+// Runs the action outside the lock so it may schedule new timers
+void TimerService::runLocked(std::unique_lock<std::mutex>& lock, const Dispatch& dispatch) {
+    lock.unlock();
+    currentOwner = dispatch.owner;
+    if (dispatch.callback) {
+        dispatch.callback(dispatch.timer);
+    }
+    currentOwner = 0;
+    lock.lock();
+
+    auto current = owners.find(dispatch.owner);
+    if (current != owners.end()) {
+        current->second.running--;
+    }
+    idleCondition.notify_all();
+}
+
+void TimerService::dispatchThreadFunction() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        if (heap.empty()) {
+            wakeCondition.wait(lock, [this] { return !heap.empty() || stopping; });
+            continue;
+        }
+
+        // Sleep until the earliest deadline; woken early by new timers,
+        // cancellation or shutdown, then re-evaluate from the top
+        auto deadline = heap.front().deadline;
+        if (Clock::now() < deadline) {
+            wakeCondition.wait_until(lock, deadline);
+            continue;
+        }
+
+        Dispatch dispatch;
+        if (takeDueLocked(Clock::now(), dispatch)) {
+            runLocked(lock, dispatch);
+        }
+    }
+}
+
+size_t TimerService::dispatchDue() {
+    if (timerFd >= 0) {
+        uint64_t expirations;
+        while (read(timerFd, &expirations, sizeof(expirations)) > 0) {
+        }
+    }
+
+    size_t fired = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    Dispatch dispatch;
+    // Only timers due on entry run now; ones re-armed or added by the
+    // actions themselves wait for the next wake-up.
+    auto now = Clock::now();
+    while (!stopping && takeDueLocked(now, dispatch)) {
+        runLocked(lock, dispatch);
+        fired++;
+    }
+    armLocked();
+    return fired;
+}
+
+// Points the timerfd at the earliest deadline (inline mode only). The
+// steady clock is CLOCK_MONOTONIC, so deadlines can be passed as absolute times.
+void TimerService::armLocked() {
+    if (timerFd < 0) return;
+
+    itimerspec spec{};
+    if (!heap.empty()) {
+        auto sinceEpoch = heap.front().deadline.time_since_epoch();
+        auto seconds = std::chrono::duration_cast<std::chrono::seconds>(sinceEpoch);
+        spec.it_value.tv_sec = seconds.count();
+        spec.it_value.tv_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(sinceEpoch - seconds).count();
+        if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0) {
+            spec.it_value.tv_nsec = 1; // All-zero would disarm the timer
+        }
+    }
+    timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
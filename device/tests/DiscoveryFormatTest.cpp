@@ -0,0 +1,179 @@
+// DiscoveryFormatTest: round-trips the discovery announcement formats.
+// Fleets of 1 to 3000 devices are packed with DiscoveryService::encode, as
+// JSON and binary, with and without byebye, and every datagram must decode
+// to the same records with both DiscoveryService::decode (device side) and
+// DeviceScanner::parseAnnouncement (client side). A few hand-written
+// datagrams check that both sides accept and reject the same input.
+#include <iostream>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <random>
+#include <algorithm>
+#include "DiscoveryService.h"
+#include "../../client/include/DeviceScanner.h"
+
+namespace {
+
+using Record = std::tuple<std::string, std::string, int>; // ID, type, port
+
+const std::string HOST = "192.168.1.23";
+const int TTL = 42;
+
+std::vector<DiscoveryService::Announcement> makeFleet(size_t count, unsigned seed) {
+    const char* types[] = {"Light", "Fan", "AC", "Heater"};
+    std::mt19937 random(seed);
+    std::vector<DiscoveryService::Announcement> fleet;
+    for (size_t i = 0; i < count; ++i) {
+        DiscoveryService::Announcement announcement;
+        // Shared prefixes, the occasional odd ID and scattered ports
+        announcement.id = "room" + std::to_string(random() % 40) + "-" + types[i % 4] + std::to_string(i);
+        if (i % 97 == 5) announcement.id += "-\"quoted\" ünïcode";
+        announcement.type = types[random() % 4];
+        announcement.port = i % 13 == 0 ? static_cast<int>(random() % 65536) : 20000 + static_cast<int>(i);
+        fleet.push_back(announcement);
+    }
+    return fleet;
+}
+
+// Decodes `datagrams` both ways; false and a message on the first disagreement
+bool decodeBoth(const std::vector<std::string>& datagrams, bool byebye, std::vector<Record>& device,
+                std::vector<Record>& client, std::string& error) {
+    for (const auto& datagram : datagrams) {
+        if (datagram.size() > DiscoveryService::MAX_DATAGRAM) {
+            error = "datagram of " + std::to_string(datagram.size()) + " bytes";
+            return false;
+        }
+        DiscoveryService::Message message;
+        DeviceScanner::Announcement announcement;
+        if (!DiscoveryService::decode(datagram.data(), datagram.size(), message)) {
+            error = "device side rejected a datagram";
+            return false;
+        }
+        if (!DeviceScanner::parseAnnouncement(datagram.data(), datagram.size(), announcement)) {
+            error = "client side rejected a datagram";
+            return false;
+        }
+        if (message.ipAddress != HOST || message.ttl != TTL || message.byebye != byebye ||
+            announcement.ttl != TTL || announcement.byebye != byebye) {
+            error = "header fields differ";
+            return false;
+        }
+        for (const auto& entry : message.announcements) {
+            device.emplace_back(entry.id, entry.type, entry.port);
+        }
+        for (const auto& entry : announcement.devices) {
+            if (entry.ipAddress != HOST) {
+                error = "client record has address " + entry.ipAddress;
+                return false;
+            }
+            client.emplace_back(entry.id, entry.type, entry.port);
+        }
+    }
+    return true;
+}
+
+bool roundTrip(size_t count, DiscoveryService::Encoding encoding, bool byebye) {
+    auto fleet = makeFleet(count, static_cast<unsigned>(count));
+    auto datagrams = DiscoveryService::encode(fleet, encoding, HOST, TTL, byebye);
+
+    std::vector<Record> expected, device, client;
+    for (const auto& entry : fleet) expected.emplace_back(entry.id, entry.type, entry.port);
+    std::string error;
+    bool ok = decodeBoth(datagrams, byebye, device, client, error);
+    if (ok) {
+        std::sort(expected.begin(), expected.end());
+        std::sort(device.begin(), device.end());
+        std::sort(client.begin(), client.end());
+        if (device != expected) error = "device side records differ";
+        else if (client != expected) error = "client side records differ";
+        ok = error.empty();
+    }
+    if (!ok) {
+        std::cerr << "FAIL " << count << " devices, " << (encoding == DiscoveryService::Encoding::BINARY ? "binary" : "json")
+                  << (byebye ? ", byebye" : "") << ": " << error << "\n";
+    }
+    return ok;
+}
+
+// Both sides must agree on whether `datagram` is an announcement, and if it
+// is, on its records and their address
+bool sameVerdict(const std::string& name, const std::string& datagram, bool valid) {
+    DiscoveryService::Message message;
+    DeviceScanner::Announcement announcement;
+    bool device = DiscoveryService::decode(datagram.data(), datagram.size(), message);
+    bool client = DeviceScanner::parseAnnouncement(datagram.data(), datagram.size(), announcement);
+    if (device != valid || client != valid) {
+        std::cerr << "FAIL " << name << ": device " << device << ", client " << client << ", expected " << valid << "\n";
+        return false;
+    }
+    if (!valid) return true;
+    bool same = message.announcements.size() == announcement.devices.size();
+    for (size_t i = 0; same && i < message.announcements.size(); ++i) {
+        const auto& a = message.announcements[i];
+        const auto& b = announcement.devices[i];
+        same = a.id == b.id && a.type == b.type && a.port == b.port && b.ipAddress == message.ipAddress;
+    }
+    if (!same) std::cerr << "FAIL " << name << ": the two sides decoded different records\n";
+    return same;
+}
+
+} // namespace
+
+int main() {
+    // The encoder logs nothing, but keep the output to the summary line
+    std::streambuf* console = std::cout.rdbuf(nullptr);
+
+    int failures = 0, runs = 0;
+    for (size_t count : {1, 2, 3, 17, 100, 1000, 3000}) {
+        for (auto encoding : {DiscoveryService::Encoding::JSON, DiscoveryService::Encoding::BINARY}) {
+            for (bool byebye : {false, true}) {
+                runs++;
+                if (!roundTrip(count, encoding, byebye)) failures++;
+            }
+        }
+    }
+
+    // An ID too long for the binary records falls back to JSON
+    {
+        auto fleet = makeFleet(5, 7);
+        fleet[2].id = std::string(300, 'x');
+        auto datagrams = DiscoveryService::encode(fleet, DiscoveryService::Encoding::BINARY, HOST, TTL);
+        std::vector<Record> device, client;
+        std::string error;
+        runs++;
+        if (!decodeBoth(datagrams, false, device, client, error) || device.size() != 5 || client.size() != 5) {
+            std::cerr << "FAIL long ID fallback: " << error << "\n";
+            failures++;
+        }
+    }
+
+    const std::string binary = DiscoveryService::encode(makeFleet(4, 1), DiscoveryService::Encoding::BINARY, HOST, TTL)[0];
+    struct Case {
+        const char* name;
+        std::string datagram;
+        bool valid;
+    } cases[] = {
+        {"single", R"({"id":"a","type":"Light","ipAddress":"10.0.0.1","port":1})", true},
+        {"aggregated", R"({"ipAddress":"10.0.0.1","ttl":6,"devices":[{"id":"a","type":"Fan","port":2}]})", true},
+        {"per-record address is ignored", R"({"ipAddress":"10.0.0.1","devices":[{"id":"a","type":"Fan","port":2,"ipAddress":"10.0.0.9"}]})", true},
+        {"no host address", R"({"devices":[{"id":"a","type":"Fan","port":2,"ipAddress":"10.0.0.9"}]})", false},
+        {"port as string", R"({"id":"a","type":"Light","ipAddress":"10.0.0.1","port":"1"})", false},
+        {"devices not an array", R"({"ipAddress":"10.0.0.1","devices":{}})", false},
+        {"record without type", R"({"ipAddress":"10.0.0.1","devices":[{"id":"a","port":2}]})", false},
+        {"query", R"({"action":"discover"})", false},
+        {"not json", "hello", false},
+        {"binary", binary, true},
+        {"binary truncated", binary.substr(0, binary.size() - 1), false},
+        {"binary trailing byte", binary + '\0', false},
+        {"binary header only", binary.substr(0, 10), false},
+    };
+    for (const auto& test : cases) {
+        runs++;
+        if (!sameVerdict(test.name, test.datagram, test.valid)) failures++;
+    }
+
+    std::cout.rdbuf(console);
+    std::cout << "DiscoveryFormatTest: " << runs - failures << " of " << runs << " cases passed\n";
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,174 @@
+// RuntimeTrackerTest: property test for the runtime and energy counters.
+// Drives a RuntimeTracker through years of random on/off cycles and power
+// changes on an injected, stepped clock, in several time zones, and after every
+// step compares its totals with a straightforward reference that splits
+// every on-interval at local midnight.
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <map>
+#include <random>
+#include <ctime>
+#include <cstdlib>
+#include <cstdint>
+#include <memory>
+#include "RuntimeTracker.h"
+
+namespace {
+
+// Stands still until the test moves it; both clocks read the same instant
+class SteppedClock : public RuntimeTracker::Clock {
+public:
+    int64_t nowMs = 0;
+
+    std::chrono::steady_clock::time_point steadyNow() const override {
+        return std::chrono::steady_clock::time_point(std::chrono::milliseconds(nowMs));
+    }
+    int64_t wallNowMs() const override {
+        return nowMs;
+    }
+};
+
+std::tm localTime(int64_t seconds) {
+    std::time_t time = static_cast<std::time_t>(seconds);
+    std::tm local{};
+    localtime_r(&time, &local);
+    return local;
+}
+
+// Start of the local day after the one containing `seconds`
+int64_t nextMidnight(int64_t seconds) {
+    std::tm local = localTime(seconds);
+    local.tm_hour = 0;
+    local.tm_min = 0;
+    local.tm_sec = 0;
+    local.tm_mday++;
+    local.tm_isdst = -1;
+    return static_cast<int64_t>(std::mktime(&local));
+}
+
+// Expected counters, kept per calendar period
+struct Reference {
+    std::map<int64_t, int64_t> dailyMs;   // Key: year * 10000 + month * 100 + day
+    std::map<int64_t, int64_t> monthlyMs; // Key: year * 100 + month
+    std::map<int64_t, int64_t> yearlyMs;
+    int64_t totalMs = 0;
+    int64_t wattMs = 0;
+
+    // Accounts [fromSeconds, toSeconds) at `power`, counting runtime if on
+    void add(int64_t fromSeconds, int64_t toSeconds, bool on, int power) {
+        wattMs += (toSeconds - fromSeconds) * 1000 * power;
+        if (!on) return;
+        totalMs += (toSeconds - fromSeconds) * 1000;
+        for (int64_t start = fromSeconds; start < toSeconds;) {
+            int64_t end = std::min(toSeconds, nextMidnight(start));
+            std::tm local = localTime(start);
+            int64_t year = local.tm_year + 1900, month = local.tm_mon + 1;
+            dailyMs[year * 10000 + month * 100 + local.tm_mday] += (end - start) * 1000;
+            monthlyMs[year * 100 + month] += (end - start) * 1000;
+            yearlyMs[year] += (end - start) * 1000;
+            start = end;
+        }
+    }
+
+    RuntimeTracker::Totals at(int64_t seconds) {
+        std::tm local = localTime(seconds);
+        int64_t year = local.tm_year + 1900, month = local.tm_mon + 1;
+        RuntimeTracker::Totals totals;
+        totals.totalRuntimeMs = totalMs;
+        totals.dailyRuntimeMs = dailyMs[year * 10000 + month * 100 + local.tm_mday];
+        totals.monthlyRuntimeMs = monthlyMs[year * 100 + month];
+        totals.yearlyRuntimeMs = yearlyMs[year];
+        totals.cumulativeWattMs = wattMs;
+        return totals;
+    }
+};
+
+std::string describe(const RuntimeTracker::Totals& totals) {
+    std::ostringstream out;
+    out << "total " << totals.totalRuntimeMs << " daily " << totals.dailyRuntimeMs
+        << " monthly " << totals.monthlyRuntimeMs << " yearly " << totals.yearlyRuntimeMs
+        << " energy " << totals.cumulativeWattMs;
+    return out.str();
+}
+
+bool same(const RuntimeTracker::Totals& a, const RuntimeTracker::Totals& b) {
+    return a.totalRuntimeMs == b.totalRuntimeMs && a.dailyRuntimeMs == b.dailyRuntimeMs &&
+           a.monthlyRuntimeMs == b.monthlyRuntimeMs && a.yearlyRuntimeMs == b.yearlyRuntimeMs &&
+           a.cumulativeWattMs == b.cumulativeWattMs;
+}
+
+// Simulates `steps` random steps starting at 2023-12-30 20:00 local time.
+// Returns false and reports the first mismatch.
+bool simulate(const std::string& zone, unsigned seed, int steps) {
+    setenv("TZ", zone.c_str(), 1);
+    tzset();
+
+    std::tm start{};
+    start.tm_year = 2023 - 1900;
+    start.tm_mon = 11;
+    start.tm_mday = 30;
+    start.tm_hour = 20;
+    start.tm_isdst = -1;
+    int64_t now = static_cast<int64_t>(std::mktime(&start));
+    auto clock = std::make_shared<SteppedClock>();
+    clock->nowMs = now * 1000;
+
+    RuntimeTracker tracker(clock);
+    Reference reference;
+    std::mt19937 random(seed);
+    bool on = false;
+    int power = 0;
+
+    for (int step = 0; step < steps; ++step) {
+        // Mostly short steps, sometimes days at once; whole seconds only
+        int64_t duration = random() % 10 == 0 ? 3600 + random() % (72 * 3600) : 60 + random() % (6 * 3600);
+        reference.add(now, now + duration, on, power);
+        now += duration;
+        clock->nowMs = now * 1000;
+
+        switch (random() % 4) {
+            case 0: // Toggle
+                on = !on;
+                power = on ? 10 + static_cast<int>(random() % 2000) : static_cast<int>(random() % 4);
+                tracker.setState(on, power);
+                break;
+            case 1: // New draw, same on flag
+                power = on ? 10 + static_cast<int>(random() % 2000) : static_cast<int>(random() % 4);
+                tracker.setState(on, power);
+                break;
+            case 2: // Periodic tick
+                tracker.updateRuntime();
+                break;
+            default: // Read only, so the boundary logic of the read path is exercised
+                break;
+        }
+
+        RuntimeTracker::Totals expected = reference.at(now);
+        RuntimeTracker::Totals actual = tracker.getTotals();
+        if (!same(expected, actual)) {
+            std::cerr << "FAIL " << zone << " seed " << seed << " step " << step << " (" << (on ? "on" : "off")
+                      << ", t=" << now << ")\n  expected " << describe(expected)
+                      << "\n  actual   " << describe(actual) << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main() {
+    const char* zones[] = {"UTC", "Europe/Berlin", "America/New_York", "Australia/Lord_Howe"};
+    const int steps = 20000; // About nine simulated years per run
+    int failures = 0, runs = 0;
+    for (const char* zone : zones) {
+        for (unsigned seed = 1; seed <= 3; ++seed) {
+            runs++;
+            if (!simulate(zone, seed, steps)) failures++;
+        }
+    }
+
+    std::cout << "RuntimeTrackerTest: " << runs - failures << " of " << runs << " runs passed\n";
+    return failures == 0 ? 0 : 1;
+}